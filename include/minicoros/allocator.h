@@ -0,0 +1,258 @@
+/// Copyright (C) 2022 Electronic Arts Inc.  All rights reserved.
+
+#ifndef MINICOROS_ALLOCATOR_H_
+#define MINICOROS_ALLOCATOR_H_
+
+#ifdef MINICOROS_CUSTOM_INCLUDE
+  #include MINICOROS_CUSTOM_INCLUDE
+#endif
+
+#ifdef MINICOROS_USE_EASTL
+  #include <eastl/allocator.h>
+  #include <eastl/shared_ptr.h>
+  #include <eastl/utility.h>
+  #include <cstddef>
+
+  #ifndef MINICOROS_STD
+    #define MINICOROS_STD eastl
+  #endif
+#else
+  #include <memory>
+  #include <new>
+  #include <utility>
+  #include <cstddef>
+
+  #ifndef MINICOROS_STD
+    #define MINICOROS_STD std
+  #endif
+
+  // Some standard libraries don't have `std::pmr` yet; define to 0 to use minicoros' own stand-in regardless
+  #ifndef MINICOROS_HAS_MEMORY_RESOURCE
+    #if __has_include(<memory_resource>)
+      #define MINICOROS_HAS_MEMORY_RESOURCE 1
+    #else
+      #define MINICOROS_HAS_MEMORY_RESOURCE 0
+    #endif
+  #endif
+
+  #if MINICOROS_HAS_MEMORY_RESOURCE
+    #include <memory_resource>
+  #endif
+#endif
+
+namespace mc {
+
+/// Where the combinators (`when_all`, `when_any`, `||`, ...) allocate their internal state from: their shared
+/// states, and the storage for their chains once it outgrows the inline capacity. `EASTLAllocatorType` under EASTL,
+/// `std::pmr::memory_resource` if the standard library has it, and a stand-in with the same interface otherwise.
+#ifdef MINICOROS_USE_EASTL
+using memory_resource = EASTLAllocatorType;
+#elif MINICOROS_HAS_MEMORY_RESOURCE
+using memory_resource = std::pmr::memory_resource;
+#else
+class memory_resource {
+public:
+  virtual ~memory_resource() = default;
+
+  void* allocate(size_t bytes, size_t alignment = alignof(max_align_t)) {
+    return do_allocate(bytes, alignment);
+  }
+
+  void deallocate(void* p, size_t bytes, size_t alignment = alignof(max_align_t)) {
+    do_deallocate(p, bytes, alignment);
+  }
+
+  bool is_equal(const memory_resource& other) const noexcept {
+    return do_is_equal(other);
+  }
+
+private:
+  virtual void* do_allocate(size_t bytes, size_t alignment) = 0;
+  virtual void do_deallocate(void* p, size_t bytes, size_t alignment) = 0;
+  virtual bool do_is_equal(const memory_resource& other) const noexcept = 0;
+};
+#endif
+
+namespace detail {
+
+#if !defined(MINICOROS_USE_EASTL) && !MINICOROS_HAS_MEMORY_RESOURCE
+
+class new_delete_memory_resource : public memory_resource {
+private:
+  void* do_allocate(size_t bytes, size_t alignment) override {
+    return ::operator new(bytes, std::align_val_t{alignment});
+  }
+
+  void do_deallocate(void* p, size_t bytes, size_t alignment) override {
+    ::operator delete(p, bytes, std::align_val_t{alignment});
+  }
+
+  bool do_is_equal(const memory_resource& other) const noexcept override {
+    return this == &other;
+  }
+};
+
+/// Standard allocator on top of a `memory_resource`, for `allocate_shared`.
+template<typename T>
+class polymorphic_allocator {
+public:
+  using value_type = T;
+
+  polymorphic_allocator(memory_resource* resource) : resource_(resource) {}
+
+  template<typename U>
+  polymorphic_allocator(const polymorphic_allocator<U>& other) : resource_(other.resource()) {}
+
+  T* allocate(size_t n) {
+    return static_cast<T*>(resource_->allocate(n * sizeof(T), alignof(T)));
+  }
+
+  void deallocate(T* p, size_t n) {
+    resource_->deallocate(p, n * sizeof(T), alignof(T));
+  }
+
+  memory_resource* resource() const {
+    return resource_;
+  }
+
+  template<typename U>
+  bool operator ==(const polymorphic_allocator<U>& other) const {return resource_ == other.resource(); }
+
+  template<typename U>
+  bool operator !=(const polymorphic_allocator<U>& other) const {return resource_ != other.resource(); }
+
+private:
+  memory_resource* resource_;
+};
+
+#endif
+
+#ifndef MINICOROS_USE_EASTL
+
+/// Resource that allocates with `operator new`.
+inline memory_resource* new_delete_resource() {
+#if MINICOROS_HAS_MEMORY_RESOURCE
+  return std::pmr::new_delete_resource();
+#else
+  static new_delete_memory_resource resource;
+  return &resource;
+#endif
+}
+
+#endif
+
+inline memory_resource*& scoped_memory_resource() {
+  static thread_local memory_resource* resource = nullptr;
+  return resource;
+}
+
+/// The resource that combinators created on this thread right now allocate from.
+inline memory_resource* current_memory_resource() {
+  if (memory_resource* resource = scoped_memory_resource())
+    return resource;
+
+#ifdef MINICOROS_USE_EASTL
+  return EASTLAllocatorDefault();
+#elif MINICOROS_HAS_MEMORY_RESOURCE
+  return std::pmr::get_default_resource();
+#else
+  return new_delete_resource();
+#endif
+}
+
+inline void* allocate_bytes(memory_resource* resource, size_t size, size_t alignment) {
+#ifdef MINICOROS_USE_EASTL
+  return resource->allocate(size, alignment, 0);
+#else
+  return resource->allocate(size, alignment);
+#endif
+}
+
+inline void deallocate_bytes(memory_resource* resource, void* p, size_t size, size_t alignment) {
+#ifdef MINICOROS_USE_EASTL
+  (void)alignment;
+  resource->deallocate(p, size);
+#else
+  resource->deallocate(p, size, alignment);
+#endif
+}
+
+#ifdef MINICOROS_USE_EASTL
+
+/// EASTL allocator that allocates from a `memory_resource`, by default the current one.
+class resource_allocator {
+public:
+  resource_allocator(const char* = nullptr) : resource_(current_memory_resource()) {}
+  explicit resource_allocator(memory_resource* resource) : resource_(resource) {}
+
+  void* allocate(size_t n, int flags = 0) {
+    (void)flags;
+    return allocate_bytes(resource_, n, EASTL_ALLOCATOR_MIN_ALIGNMENT);
+  }
+
+  void* allocate(size_t n, size_t alignment, size_t offset, int flags = 0) {
+    (void)offset;
+    (void)flags;
+    return allocate_bytes(resource_, n, alignment);
+  }
+
+  void deallocate(void* p, size_t n) {
+    deallocate_bytes(resource_, p, n, EASTL_ALLOCATOR_MIN_ALIGNMENT);
+  }
+
+  const char* get_name() const {return "minicoros"; }
+  void set_name(const char*) {}
+
+  bool operator ==(const resource_allocator& other) const {return resource_ == other.resource_; }
+  bool operator !=(const resource_allocator& other) const {return resource_ != other.resource_; }
+
+private:
+  memory_resource* resource_;
+};
+
+#endif
+
+/// Creates the shared state of a combinator in memory from `resource`.
+template<typename T, typename... ArgTypes>
+MINICOROS_STD::shared_ptr<T> allocate_state(memory_resource* resource, ArgTypes&&... args) {
+#ifdef MINICOROS_USE_EASTL
+  return eastl::allocate_shared<T>(resource_allocator{resource}, MINICOROS_STD::forward<ArgTypes>(args)...);
+#elif MINICOROS_HAS_MEMORY_RESOURCE
+  return std::allocate_shared<T>(std::pmr::polymorphic_allocator<T>{resource}, MINICOROS_STD::forward<ArgTypes>(args)...);
+#else
+  return std::allocate_shared<T>(polymorphic_allocator<T>{resource}, MINICOROS_STD::forward<ArgTypes>(args)...);
+#endif
+}
+
+} // detail
+
+/// Makes the combinators created on this thread while the scope is alive allocate their internal state from
+/// `resource`, which has to outlive the combinators. Scopes nest; the innermost one wins. The resource is picked up
+/// when a combinator is created, so it doesn't matter where or when the resulting future is evaluated.
+///
+/// ```cpp
+/// {
+///   mc::allocator_scope scope{frame_arena};
+///   return when_all(std::move(requests));
+/// }
+/// ```
+class allocator_scope {
+public:
+  explicit allocator_scope(memory_resource& resource) : previous_(detail::scoped_memory_resource()) {
+    detail::scoped_memory_resource() = &resource;
+  }
+
+  allocator_scope(const allocator_scope&) = delete;
+  allocator_scope& operator =(const allocator_scope&) = delete;
+
+  ~allocator_scope() {
+    detail::scoped_memory_resource() = previous_;
+  }
+
+private:
+  memory_resource* previous_;
+};
+
+} // mc
+
+#endif // MINICOROS_ALLOCATOR_H_
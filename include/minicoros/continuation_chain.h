@@ -10,6 +10,8 @@
 #ifdef MINICOROS_USE_EASTL
   #include <eastl/utility.h>
   #include <eastl/functional.h>
+  #include <eastl/shared_ptr.h>
+  #include <eastl/atomic.h>
   #include <cassert>
 
   #ifndef MINICOROS_STD
@@ -22,6 +24,8 @@
 #else
   #include <utility>
   #include <functional>
+  #include <memory>
+  #include <atomic>
   #include <cassert>
 
   #ifndef MINICOROS_STD
@@ -41,6 +45,67 @@ using continuation = MINICOROS_FUNCTION_TYPE<void(ResultType&&)>;
 template<typename InputType, typename OutputType>
 using functor = MINICOROS_FUNCTION_TYPE<void(InputType&&, continuation<OutputType>&&)>;
 
+namespace detail {
+
+class cancellation_state;
+
+/// The cancellation state that chains evaluated on this thread right now belong to, if any.
+inline const MINICOROS_STD::shared_ptr<cancellation_state>*& current_cancellation_state() {
+  static thread_local const MINICOROS_STD::shared_ptr<cancellation_state>* state = nullptr;
+  return state;
+}
+
+/// Cancellation flag of a combinator (`when_any`, `||`, ...) that its children check before running each handler.
+/// Combinators nest, so a child is also cancelled when any of the combinators further up is.
+class cancellation_state {
+public:
+  cancellation_state() {
+    if (const MINICOROS_STD::shared_ptr<cancellation_state>* current = current_cancellation_state())
+      parent_ = *current;
+  }
+
+  cancellation_state(const cancellation_state&) = delete;
+  cancellation_state& operator =(const cancellation_state&) = delete;
+
+  void cancel() {
+    cancelled_.store(true, MINICOROS_STD::memory_order_relaxed);
+  }
+
+  bool cancelled() const {
+    return cancelled_.load(MINICOROS_STD::memory_order_relaxed) || (parent_ && parent_->cancelled());
+  }
+
+private:
+  MINICOROS_STD::atomic<bool> cancelled_{false};
+  MINICOROS_STD::shared_ptr<cancellation_state> parent_;
+};
+
+/// Makes chains evaluated within the scope belong to `state`, which has to outlive the scope.
+class cancellation_scope {
+public:
+  explicit cancellation_scope(const MINICOROS_STD::shared_ptr<cancellation_state>& state) : previous_(current_cancellation_state()) {
+    current_cancellation_state() = &state;
+  }
+
+  cancellation_scope(const cancellation_scope&) = delete;
+  cancellation_scope& operator =(const cancellation_scope&) = delete;
+
+  ~cancellation_scope() {
+    current_cancellation_state() = previous_;
+  }
+
+private:
+  const MINICOROS_STD::shared_ptr<cancellation_state>* previous_;
+};
+
+/// Null, without touching any reference count, for chains evaluated outside of any combinator.
+inline MINICOROS_STD::shared_ptr<cancellation_state> capture_cancellation_state() {
+  const MINICOROS_STD::shared_ptr<cancellation_state>* current = current_cancellation_state();
+  return current ? *current : nullptr;
+}
+
+} // detail
+
 /// The continuation chain monad, implements a lazy/async (based on promises) evaluation model and
 /// is the core component that this library is built around.
 /// Works by creating a chain of "activators" (promise of promises) that gets evaluated bottom-up.
@@ -61,7 +126,7 @@ class continuation_chain
 {
 public:
   continuation_chain(continuation<continuation<T>>&& fun);
-  continuation_chain(continuation_chain<T>&& other);
+  continuation_chain(continuation_chain<T>&& other) noexcept;
 
   // NOTE: this copy-ctor is needed because std::function requires the lambda to be copy-constructible.
   //       We don't really copy any functions containing continuation_chains, so when we have support for
@@ -93,7 +158,7 @@ template<typename T>
 continuation_chain<T>::continuation_chain(continuation<continuation<T>>&& fun) : activator_(MINICOROS_STD::move(fun)) {}
 
 template<typename T>
-continuation_chain<T>::continuation_chain(continuation_chain<T>&& other) { activator_.swap(other.activator_); }
+continuation_chain<T>::continuation_chain(continuation_chain<T>&& other) noexcept { activator_.swap(other.activator_); }
 
 template<typename T>
 template<typename ResultType, typename TransformType>
@@ -107,9 +172,26 @@ continuation_chain<ResultType> continuation_chain<T>::transform(TransformType&&
       parent_activator(
         [
           next_continuation = MINICOROS_STD::move(next_continuation),
-          transformation = MINICOROS_STD::forward<TransformType>(transformation)
+          transformation = MINICOROS_STD::forward<TransformType>(transformation),
+          cancellation = detail::capture_cancellation_state()
         ]
         (T&& input) mutable {
+          // Chains outside of any combinator, evaluated outside of any combinator: nothing to check or set up
+          if (!cancellation && !detail::current_cancellation_state()) {
+            transformation(MINICOROS_STD::move(input), MINICOROS_STD::move(next_continuation));
+            return;
+          }
+
+          // The combinator evaluating this chain isn't interested in the result anymore; skip the rest of the chain
+          // (`finally` handlers included) and release it
+          if (cancellation && cancellation->cancelled()) {
+            next_continuation = nullptr;
+            return;
+          }
+
+          // Chains evaluated by the functor belong to the same combinator as this one
+          detail::cancellation_scope scope{cancellation};
+
           // This gets invoked through the continuation; it's the part of the evaluation flow that actually calls the code and binds it with a continuation
           // that evaluates the next functor of the chain.
           transformation(MINICOROS_STD::move(input), MINICOROS_STD::move(next_continuation));
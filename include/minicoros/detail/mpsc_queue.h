@@ -0,0 +1,124 @@
+/// Copyright (C) 2022 Electronic Arts Inc.  All rights reserved.
+
+#ifndef MINICOROS_DETAIL_MPSC_QUEUE_H_
+#define MINICOROS_DETAIL_MPSC_QUEUE_H_
+
+#ifdef MINICOROS_CUSTOM_INCLUDE
+  #include MINICOROS_CUSTOM_INCLUDE
+#endif
+
+#ifdef MINICOROS_USE_EASTL
+  #include <eastl/atomic.h>
+  #include <eastl/utility.h>
+
+  #ifndef MINICOROS_STD
+    #define MINICOROS_STD eastl
+  #endif
+#else
+  #include <atomic>
+  #include <utility>
+
+  #ifndef MINICOROS_STD
+    #define MINICOROS_STD std
+  #endif
+#endif
+
+namespace mc::detail {
+
+/// Lock-free multi-producer, single-consumer queue of nodes that have a `next` pointer (`NodeType* next`). Producers
+/// push onto an atomic stack; the consumer takes the whole stack with one exchange and reverses it to get the nodes
+/// in the order they were pushed. The queue doesn't own the nodes.
+template<typename NodeType>
+class intrusive_mpsc_queue {
+public:
+  intrusive_mpsc_queue() = default;
+  intrusive_mpsc_queue(const intrusive_mpsc_queue&) = delete;
+  intrusive_mpsc_queue& operator =(const intrusive_mpsc_queue&) = delete;
+
+  /// Any thread.
+  void push(NodeType* n) {
+    n->next = head_.load(MINICOROS_STD::memory_order_relaxed);
+
+    while (!head_.compare_exchange_weak(n->next, n, MINICOROS_STD::memory_order_release, MINICOROS_STD::memory_order_relaxed))
+      ;
+  }
+
+  /// Consumer thread only. Takes everything pushed so far and returns it as a list linked through `next`, oldest
+  /// first.
+  NodeType* take_all() {
+    NodeType* newest = head_.exchange(nullptr, MINICOROS_STD::memory_order_acquire);
+    NodeType* oldest = nullptr;
+
+    while (newest) {
+      NodeType* next = newest->next;
+      newest->next = oldest;
+      oldest = newest;
+      newest = next;
+    }
+
+    return oldest;
+  }
+
+  /// Any thread, but only a hint when there are producers.
+  bool empty() const {
+    return head_.load(MINICOROS_STD::memory_order_relaxed) == nullptr;
+  }
+
+private:
+  MINICOROS_STD::atomic<NodeType*> head_{nullptr};
+};
+
+/// `intrusive_mpsc_queue` for values that don't have a `next` pointer of their own.
+template<typename T>
+class mpsc_queue {
+public:
+  mpsc_queue() = default;
+  mpsc_queue(const mpsc_queue&) = delete;
+  mpsc_queue& operator =(const mpsc_queue&) = delete;
+
+  ~mpsc_queue() {
+    for (node* n = nodes_.take_all(); n;) {
+      node* next = n->next;
+      delete n;
+      n = next;
+    }
+  }
+
+  /// Any thread.
+  void push(T&& value) {
+    nodes_.push(new node{MINICOROS_STD::move(value), nullptr});
+  }
+
+  /// Consumer thread only. Hands everything pushed so far to `consumer`, oldest first, and returns how many values
+  /// there were.
+  template<typename ConsumerType>
+  size_t drain(ConsumerType&& consumer) {
+    size_t count = 0;
+
+    for (node* n = nodes_.take_all(); n; ++count) {
+      node* next = n->next;
+      consumer(MINICOROS_STD::move(n->value));
+      delete n;
+      n = next;
+    }
+
+    return count;
+  }
+
+  /// Any thread, but only a hint when there are producers.
+  bool empty() const {
+    return nodes_.empty();
+  }
+
+private:
+  struct node {
+    T value;
+    node* next;
+  };
+
+  intrusive_mpsc_queue<node> nodes_;
+};
+
+} // mc::detail
+
+#endif // MINICOROS_DETAIL_MPSC_QUEUE_H_
@@ -9,6 +9,8 @@
 
 #include <minicoros/types.h>
 #include <minicoros/continuation_chain.h>
+#include <minicoros/allocator.h>
+#include <minicoros/detail/small_vector.h>
 
 #ifdef MINICOROS_USE_EASTL
   #include <eastl/tuple.h>
@@ -16,6 +18,7 @@
   #include <eastl/vector.h>
   #include <eastl/optional.h>
   #include <eastl/shared_ptr.h>
+  #include <eastl/variant.h>
 
   #ifndef MINICOROS_STD
     #define MINICOROS_STD eastl
@@ -26,6 +29,7 @@
   #include <vector>
   #include <optional>
   #include <memory>
+  #include <variant>
 
   #ifndef MINICOROS_STD
     #define MINICOROS_STD std
@@ -34,6 +38,10 @@
 
 namespace mc::detail {
 
+/// Storage for the chains of a combinator. Small fan-outs (the common case) are stored inline.
+template<typename T>
+using chain_vector = small_vector<continuation_chain<concrete_result<T>>, MINICOROS_SMALL_VECTOR_SIZE>;
+
 template<typename T>
 MINICOROS_STD::tuple<MINICOROS_STD::remove_reference_t<T>> convert_to_tuple(T&& value) {
   return MINICOROS_STD::tuple<T>(MINICOROS_STD::move(value));
@@ -44,15 +52,31 @@ MINICOROS_STD::tuple<MINICOROS_STD::remove_reference_t<Args>...> convert_to_tupl
   return MINICOROS_STD::move(tup);
 }
 
-template<typename A, typename B>
-auto make_flat_tuple(A&& a, B&& b) {
-  auto tup1 = convert_to_tuple(MINICOROS_STD::move(a));
-  auto tup2 = convert_to_tuple(MINICOROS_STD::move(b));
-  return MINICOROS_STD::tuple_cat(MINICOROS_STD::move(tup1), MINICOROS_STD::move(tup2));
+/// Base for the shared states of combinators. Children evaluated within a `cancellation_scope` for the state (see
+/// `cancellation_of`) are cancelled once the state resolves: their remaining handlers are skipped and released.
+class cancellable {
+public:
+  cancellation_state& cancellation() {
+    return cancellation_;
+  }
+
+protected:
+  void cancel_children() {
+    cancellation_.cancel();
+  }
+
+private:
+  cancellation_state cancellation_;
+};
+
+/// Returns the cancellation state of a combinator's shared state, sharing ownership with it.
+template<typename StateType>
+MINICOROS_STD::shared_ptr<cancellation_state> cancellation_of(const MINICOROS_STD::shared_ptr<StateType>& state) {
+  return MINICOROS_STD::shared_ptr<cancellation_state>(state, &state->cancellation());
 }
 
 template<typename T>
-class vector_result {
+class vector_result : public cancellable {
 public:
   using value_type = MINICOROS_STD::vector<T>;
 
@@ -79,6 +103,8 @@ private:
     if (!promise_)
       return;
 
+    cancel_children();
+
     auto promise = MINICOROS_STD::move(promise_);
     promise_ = {};
     promise(MINICOROS_STD::move(value));
@@ -90,7 +116,7 @@ private:
 };
 
 template<>
-class vector_result<void> {
+class vector_result<void> : public cancellable {
 public:
   using value_type = void;
 
@@ -121,6 +147,8 @@ private:
     if (!promise_)
       return;
 
+    cancel_children();
+
     auto promise = MINICOROS_STD::move(promise_);
     promise_ = {};
     promise(MINICOROS_STD::move(value));
@@ -131,228 +159,419 @@ private:
   promise<void> promise_;
 };
 
-template<typename LHS, typename RHS>
-class tuple_result {
+/// Storage for one operand of `join_result`. The value is handed out as a tuple so that all operands can be
+/// concatenated in one go; `void` operands don't store anything and contribute an empty tuple.
+template<typename T>
+class join_slot {
 public:
-  using value_type = decltype(make_flat_tuple(MINICOROS_STD::declval<LHS>(), MINICOROS_STD::declval<RHS>()));
+  void assign(T&& value) {
+    value_.emplace(MINICOROS_STD::move(value));
+  }
 
-  tuple_result(promise<value_type>&& p) : promise_(MINICOROS_STD::move(p)) {}
+  auto take() {
+    return convert_to_tuple(MINICOROS_STD::move(*value_));
+  }
 
-  void assign_lhs(concrete_result<LHS>&& result) {
-    if (auto fail = result.get_failure()) {
-      resolve(MINICOROS_STD::move(*fail));
-      return;
-    }
+private:
+  MINICOROS_STD::optional<T> value_;
+};
 
-    lhs_.emplace(MINICOROS_STD::move(*result.get_value()));
-    check_and_resolve();
+template<>
+class join_slot<void> {
+public:
+  MINICOROS_STD::tuple<> take() {
+    return {};
   }
+};
+
+/// Maps the flattened tuple of a join to the type the resulting future holds: `void` for no values, the naked
+/// type for a single value, and the tuple itself otherwise.
+template<typename TupleType>
+struct join_value_type {
+  using type = TupleType;
+};
 
-  void assign_rhs(concrete_result<RHS>&& result) {
+template<>
+struct join_value_type<MINICOROS_STD::tuple<>> {
+  using type = void;
+};
+
+template<typename T>
+struct join_value_type<MINICOROS_STD::tuple<T>> {
+  using type = T;
+};
+
+/// Shared state for joining N futures of (possibly) different types. All the values are stored side by side and
+/// concatenated into a single flat tuple once the last future has finished.
+template<typename... Ts>
+class join_result : public cancellable {
+  using FlatTupleType = decltype(MINICOROS_STD::tuple_cat(MINICOROS_STD::declval<join_slot<Ts>&>().take()...));
+
+public:
+  using value_type = typename join_value_type<FlatTupleType>::type;
+
+  join_result(promise<value_type>&& p) : promise_(MINICOROS_STD::move(p)) {}
+
+  template<size_t Index, typename T>
+  void assign(concrete_result<T>&& result) {
     if (auto fail = result.get_failure()) {
       resolve(MINICOROS_STD::move(*fail));
       return;
     }
 
-    rhs_.emplace(MINICOROS_STD::move(*result.get_value()));
-    check_and_resolve();
+    if constexpr (!MINICOROS_STD::is_void_v<T>)
+      MINICOROS_STD::get<Index>(slots_).assign(MINICOROS_STD::move(*result.get_value()));
+
+    if (++num_finished_futures_ == sizeof...(Ts))
+      resolve_with_values(MINICOROS_STD::index_sequence_for<Ts...>());
   }
 
 private:
-  void check_and_resolve() {
-    if (lhs_ && rhs_)
-      resolve(make_flat_tuple(MINICOROS_STD::move(*lhs_), MINICOROS_STD::move(*rhs_)));
+  template<size_t... Indexes>
+  void resolve_with_values(MINICOROS_STD::index_sequence<Indexes...>) {
+    auto values = MINICOROS_STD::tuple_cat(MINICOROS_STD::get<Indexes>(slots_).take()...);
+
+    if constexpr (MINICOROS_STD::is_void_v<value_type>)
+      resolve({});
+    else if constexpr (MINICOROS_STD::tuple_size_v<FlatTupleType> == 1)
+      resolve(MINICOROS_STD::move(MINICOROS_STD::get<0>(values)));
+    else
+      resolve(MINICOROS_STD::move(values));
   }
 
   void resolve(concrete_result<value_type>&& value) {
     if (!promise_)
       return;
 
+    cancel_children();
+
     auto promise = MINICOROS_STD::move(promise_);
     promise_ = {};
     promise(MINICOROS_STD::move(value));
   }
 
-  MINICOROS_STD::optional<LHS> lhs_;
-  MINICOROS_STD::optional<RHS> rhs_;
+  MINICOROS_STD::tuple<join_slot<Ts>...> slots_;
+  size_t num_finished_futures_ = 0;
   promise<value_type> promise_;
 };
 
-template<typename LHS>
-class tuple_result<LHS, void> {
+/// Evaluates each chain into the result builder, using `assign<Index>` where `Index` is the position of the chain.
+template<typename ResultBuilderType, typename... Ts, size_t... Indexes>
+void evaluate_into_indexed(MINICOROS_STD::tuple<continuation_chain<concrete_result<Ts>>...>&& chains,
+                           const MINICOROS_STD::shared_ptr<ResultBuilderType>& result_builder,
+                           MINICOROS_STD::index_sequence<Indexes...>) {
+  auto cancellation = cancellation_of(result_builder);
+  cancellation_scope scope{cancellation};
+
+  (MINICOROS_STD::move(MINICOROS_STD::get<Indexes>(chains)).evaluate_into([result_builder] (concrete_result<Ts>&& result) {
+    result_builder->template assign<Indexes>(MINICOROS_STD::move(result));
+  }), ...);
+}
+
+template<typename T>
+class any_result : public cancellable {
 public:
-  using value_type = LHS;
+  using value_type = T;
 
-  tuple_result(promise<value_type>&& p) : promise_(MINICOROS_STD::move(p)) {}
+  any_result(promise<T>&& promise) : promise_(MINICOROS_STD::move(promise)) {}
 
-  void assign_lhs(concrete_result<LHS>&& result) {
-    if (auto fail = result.get_failure()) {
-      resolve(MINICOROS_STD::move(*fail));
+  /// First invocation resolves the promise
+  void assign(concrete_result<T>&& result) {
+    if (!promise_)
       return;
-    }
 
-    lhs_.emplace(MINICOROS_STD::move(*result.get_value()));
-    check_and_resolve();
+    cancel_children();
+
+    auto promise = MINICOROS_STD::move(promise_);
+    promise_ = {};
+    promise(MINICOROS_STD::move(result));
   }
 
-  void assign_rhs(concrete_result<void>&& result) {
+private:
+  promise<T> promise_;
+};
+
+/// Resolves once `needed` of the futures have succeeded, with their values in the order they arrived. Fails as soon
+/// as so many futures have failed that `needed` can no longer be reached.
+template<typename T>
+class quorum_result : public cancellable {
+public:
+  using value_type = MINICOROS_STD::vector<T>;
+
+  quorum_result(promise<value_type>&& p, size_t needed, size_t num_futures)
+    : promise_(MINICOROS_STD::move(p))
+    , needed_(needed)
+    , allowed_failures_(num_futures - needed) {
+    values_.reserve(needed);
+  }
+
+  void assign(concrete_result<T>&& result) {
+    if (!promise_)
+      return;
+
     if (auto fail = result.get_failure()) {
-      resolve(MINICOROS_STD::move(*fail));
+      if (num_failures_++ == allowed_failures_)
+        resolve(MINICOROS_STD::move(*fail));
+
       return;
     }
 
-    received_rhs_ = true;
-    check_and_resolve();
-  }
+    values_.push_back(MINICOROS_STD::move(*result.get_value()));
 
-private:
-  void check_and_resolve() {
-    if (lhs_ && received_rhs_)
-      resolve(MINICOROS_STD::move(*lhs_));
+    if (values_.size() == needed_)
+      resolve(MINICOROS_STD::move(values_));
   }
 
+private:
   void resolve(concrete_result<value_type>&& value) {
-    if (!promise_)
-      return;
+    cancel_children();
 
     auto promise = MINICOROS_STD::move(promise_);
     promise_ = {};
     promise(MINICOROS_STD::move(value));
   }
 
-  MINICOROS_STD::optional<LHS> lhs_;
-  bool received_rhs_ = false;
   promise<value_type> promise_;
+  value_type values_;
+  size_t needed_;
+  size_t allowed_failures_;
+  size_t num_failures_ = 0;
 };
 
-template<typename RHS>
-class tuple_result<void, RHS> {
+template<>
+class quorum_result<void> : public cancellable {
 public:
-  using value_type = RHS;
+  using value_type = void;
+
+  quorum_result(promise<value_type>&& p, size_t needed, size_t num_futures)
+    : promise_(MINICOROS_STD::move(p))
+    , needed_(needed)
+    , allowed_failures_(num_futures - needed) {}
 
-  tuple_result(promise<value_type>&& p) : promise_(MINICOROS_STD::move(p)) {}
+  void assign(concrete_result<void>&& result) {
+    if (!promise_)
+      return;
 
-  void assign_lhs(concrete_result<void>&& result) {
     if (auto fail = result.get_failure()) {
-      resolve(MINICOROS_STD::move(*fail));
+      if (num_failures_++ == allowed_failures_)
+        resolve(MINICOROS_STD::move(*fail));
+
       return;
     }
 
-    received_lhs_ = true;
-    check_and_resolve();
+    if (++num_successes_ == needed_)
+      resolve({});
+  }
+
+private:
+  void resolve(concrete_result<value_type>&& value) {
+    cancel_children();
+
+    auto promise = MINICOROS_STD::move(promise_);
+    promise_ = {};
+    promise(MINICOROS_STD::move(value));
+  }
+
+  promise<value_type> promise_;
+  size_t needed_;
+  size_t allowed_failures_;
+  size_t num_successes_ = 0;
+  size_t num_failures_ = 0;
+};
+
+/// Default error reducer for `success_result`: the last error wins.
+struct last_error {
+  MINICOROS_ERROR_TYPE operator ()(MINICOROS_STD::vector<MINICOROS_ERROR_TYPE>&& errors) const {
+    return MINICOROS_STD::move(errors.back());
+  }
+};
+
+/// Resolves with the first successful result. Errors are collected until every future has failed, at which point
+/// they're reduced into the single error that's propagated.
+template<typename T, typename ErrorReducerType>
+class success_result : public cancellable {
+public:
+  using value_type = T;
+
+  success_result(promise<T>&& p, size_t num_futures, ErrorReducerType&& error_reducer)
+    : promise_(MINICOROS_STD::move(p))
+    , num_futures_(num_futures)
+    , error_reducer_(MINICOROS_STD::move(error_reducer)) {
+    errors_.reserve(num_futures);
   }
 
-  void assign_rhs(concrete_result<RHS>&& result) {
+  void assign(concrete_result<T>&& result) {
+    if (!promise_)
+      return;
+
     if (auto fail = result.get_failure()) {
-      resolve(MINICOROS_STD::move(*fail));
+      errors_.push_back(MINICOROS_STD::move(fail->error));
+
+      if (errors_.size() == num_futures_)
+        resolve(failure{error_reducer_(MINICOROS_STD::move(errors_))});
+
       return;
     }
 
-    rhs_.emplace(MINICOROS_STD::move(*result.get_value()));
-    check_and_resolve();
+    resolve(MINICOROS_STD::move(result));
   }
 
 private:
-  void check_and_resolve() {
-    if (received_lhs_ && rhs_)
-      resolve(MINICOROS_STD::move(*rhs_));
+  void resolve(concrete_result<T>&& result) {
+    cancel_children();
+
+    auto promise = MINICOROS_STD::move(promise_);
+    promise_ = {};
+    promise(MINICOROS_STD::move(result));
   }
 
-  void resolve(concrete_result<value_type>&& value) {
+  promise<T> promise_;
+  size_t num_futures_;
+  MINICOROS_STD::vector<MINICOROS_ERROR_TYPE> errors_;
+  ErrorReducerType error_reducer_;
+};
+
+/// Alternative type used for a `future<T>` in the variant that `variant_any_result` resolves to.
+template<typename T>
+using any_alternative_t = MINICOROS_STD::conditional_t<MINICOROS_STD::is_void_v<T>, MINICOROS_STD::monostate, T>;
+
+/// Like `any_result`, but for futures of different types. Resolves to a variant where the index of the alternative
+/// is the index of the future that finished first.
+template<typename... Ts>
+class variant_any_result : public cancellable {
+public:
+  using value_type = MINICOROS_STD::variant<any_alternative_t<Ts>...>;
+
+  variant_any_result(promise<value_type>&& p) : promise_(MINICOROS_STD::move(p)) {}
+
+  /// First invocation resolves the promise
+  template<size_t Index, typename T>
+  void assign(concrete_result<T>&& result) {
     if (!promise_)
       return;
 
+    if (auto fail = result.get_failure())
+      resolve(MINICOROS_STD::move(*fail));
+    else if constexpr (MINICOROS_STD::is_void_v<T>)
+      resolve(value_type{MINICOROS_STD::in_place_index<Index>});
+    else
+      resolve(value_type{MINICOROS_STD::in_place_index<Index>, MINICOROS_STD::move(*result.get_value())});
+  }
+
+private:
+  void resolve(concrete_result<value_type>&& value) {
+    cancel_children();
+
     auto promise = MINICOROS_STD::move(promise_);
     promise_ = {};
     promise(MINICOROS_STD::move(value));
   }
 
-  bool received_lhs_ = false;
-  MINICOROS_STD::optional<RHS> rhs_;
   promise<value_type> promise_;
 };
 
-template<>
-class tuple_result<void, void> {
+/// Hands each result to a handler as soon as it arrives, and resolves once all results have been handled. The first
+/// failure is propagated; no results are handled after that.
+template<typename T, typename HandlerType>
+class each_result : public cancellable {
 public:
-  using value_type = void;
-
-  tuple_result(promise<value_type>&& p) : promise_(MINICOROS_STD::move(p)) {}
+  each_result(promise<void>&& p, size_t num_expected_futures, HandlerType&& handler)
+    : handler_(MINICOROS_STD::move(handler)), num_expected_futures_(num_expected_futures), promise_(MINICOROS_STD::move(p)) {}
 
-  void assign_lhs(concrete_result<void>&& result) {
-    if (auto fail = result.get_failure()) {
-      resolve(MINICOROS_STD::move(*fail));
+  void assign(size_t index, concrete_result<T>&& result) {
+    if (!promise_)
       return;
-    }
-
-    received_lhs_ = true;
-    check_and_resolve();
-  }
 
-  void assign_rhs(concrete_result<void>&& result) {
     if (auto fail = result.get_failure()) {
       resolve(MINICOROS_STD::move(*fail));
       return;
     }
 
-    received_rhs_ = true;
-    check_and_resolve();
-  }
+    if constexpr (MINICOROS_STD::is_void_v<T>)
+      handler_(index);
+    else
+      handler_(index, MINICOROS_STD::move(*result.get_value()));
 
-private:
-  void check_and_resolve() {
-    if (received_lhs_ && received_rhs_)
+    if (++num_finished_futures_ == num_expected_futures_)
       resolve({});
   }
 
-  void resolve(concrete_result<value_type>&& value) {
+private:
+  void resolve(concrete_result<void>&& value) {
     if (!promise_)
       return;
 
+    cancel_children();
+
     auto promise = MINICOROS_STD::move(promise_);
     promise_ = {};
     promise(MINICOROS_STD::move(value));
   }
 
-  bool received_lhs_ = false;
-  bool received_rhs_ = false;
-  promise<value_type> promise_;
+  HandlerType handler_;
+  size_t num_finished_futures_ = 0;
+  size_t num_expected_futures_;
+  promise<void> promise_;
 };
 
-template<typename T>
-class any_result {
+/// Folds each result into an accumulator as soon as it arrives, and resolves to the accumulator once all results
+/// have been folded. The first failure is propagated.
+template<typename T, typename AccumulatorType, typename OperationType>
+class reduce_result : public cancellable {
 public:
-  using value_type = T;
-
-  any_result(promise<T>&& promise) : promise_(MINICOROS_STD::move(promise)) {}
+  reduce_result(promise<AccumulatorType>&& p, size_t num_expected_futures, AccumulatorType&& init, OperationType&& operation)
+    : accumulator_(MINICOROS_STD::move(init)), operation_(MINICOROS_STD::move(operation)), num_expected_futures_(num_expected_futures), promise_(MINICOROS_STD::move(p)) {}
 
-  /// First invocation resolves the promise
   void assign(concrete_result<T>&& result) {
     if (!promise_)
       return;
 
+    if (auto fail = result.get_failure()) {
+      resolve(MINICOROS_STD::move(*fail));
+      return;
+    }
+
+    accumulator_ = operation_(MINICOROS_STD::move(accumulator_), MINICOROS_STD::move(*result.get_value()));
+
+    if (++num_finished_futures_ == num_expected_futures_)
+      resolve(MINICOROS_STD::move(accumulator_));
+  }
+
+private:
+  void resolve(concrete_result<AccumulatorType>&& value) {
+    if (!promise_)
+      return;
+
+    cancel_children();
+
     auto promise = MINICOROS_STD::move(promise_);
     promise_ = {};
-    promise(MINICOROS_STD::move(result));
+    promise(MINICOROS_STD::move(value));
   }
 
-private:
-  promise<T> promise_;
+  AccumulatorType accumulator_;
+  OperationType operation_;
+  size_t num_finished_futures_ = 0;
+  size_t num_expected_futures_;
+  promise<AccumulatorType> promise_;
 };
 
 template<typename T>
 class seq_submitter : public MINICOROS_STD::enable_shared_from_this<seq_submitter<T>> {
   using ResultingType = typename vector_result<T>::value_type;
-  using ChainType = continuation_chain<concrete_result<T>>;
 
 public:
-  seq_submitter(promise<ResultingType>&& p, MINICOROS_STD::vector<ChainType>&& chains) : storage_(MINICOROS_STD::move(p)), chains_(MINICOROS_STD::move(chains)) {}
+  seq_submitter(promise<ResultingType>&& p, chain_vector<T>&& chains) : storage_(MINICOROS_STD::move(p)), chains_(MINICOROS_STD::move(chains)) {}
 
   void evaluate() {
     storage_.resize(chains_.size());
     evaluate_next_chain();
   }
 
+  cancellation_state& cancellation() {
+    return storage_.cancellation();
+  }
+
 private:
   using MINICOROS_STD::enable_shared_from_this<seq_submitter<T>>::shared_from_this;
 
@@ -362,18 +581,409 @@ private:
       return;
     }
 
+    // Failed, or cancelled from further up
+    if (cancellation().cancelled())
+      return;
+
     const size_t chain_idx = next_chain_idx_++;
     auto& chain = chains_[chain_idx];
+    auto shared_this = shared_from_this();
+    auto cancellation = cancellation_of(shared_this);
+    cancellation_scope scope{cancellation};
 
-    MINICOROS_STD::move(chain).evaluate_into([shared_this = shared_from_this()] (concrete_result<T>&& result) {
+    MINICOROS_STD::move(chain).evaluate_into([shared_this = MINICOROS_STD::move(shared_this)] (concrete_result<T>&& result) {
       shared_this->storage_.assign(shared_this->next_chain_idx_ - 1, MINICOROS_STD::move(result));
       shared_this->evaluate_next_chain();
     });
   }
 
   vector_result<T> storage_;
-  MINICOROS_STD::vector<ChainType> chains_;
+  chain_vector<T> chains_;
+  size_t next_chain_idx_ = 0u;
+};
+
+/// Evaluates chains in order, with at most `max_in_flight` of them evaluating at the same time.
+template<typename T>
+class limited_submitter : public MINICOROS_STD::enable_shared_from_this<limited_submitter<T>> {
+  using ResultingType = typename vector_result<T>::value_type;
+
+public:
+  limited_submitter(promise<ResultingType>&& p, chain_vector<T>&& chains, size_t max_in_flight)
+    : storage_(MINICOROS_STD::move(p)), chains_(MINICOROS_STD::move(chains)), max_in_flight_(max_in_flight) {}
+
+  void evaluate() {
+    storage_.resize(chains_.size());
+    evaluate_next_chains();
+  }
+
+  cancellation_state& cancellation() {
+    return storage_.cancellation();
+  }
+
+private:
+  using MINICOROS_STD::enable_shared_from_this<limited_submitter<T>>::shared_from_this;
+
+  void evaluate_next_chains() {
+    // Chains that finish synchronously call back into here. Leave it to the outermost call to evaluate the next
+    // chains so that the stack doesn't grow with the number of chains.
+    if (evaluating_)
+      return;
+
+    evaluating_ = true;
+
+    auto cancellation = cancellation_of(shared_from_this());
+    cancellation_scope scope{cancellation};
+
+    // Stop when failed, or cancelled from further up
+    while (num_in_flight_ < max_in_flight_ && next_chain_idx_ < chains_.size() && !cancellation->cancelled()) {
+      const size_t chain_idx = next_chain_idx_++;
+      ++num_in_flight_;
+
+      MINICOROS_STD::move(chains_[chain_idx]).evaluate_into([shared_this = shared_from_this(), chain_idx] (concrete_result<T>&& result) {
+        --shared_this->num_in_flight_;
+        shared_this->storage_.assign(chain_idx, MINICOROS_STD::move(result));
+        shared_this->evaluate_next_chains();
+      });
+    }
+
+    evaluating_ = false;
+  }
+
+  vector_result<T> storage_;
+  chain_vector<T> chains_;
+  size_t max_in_flight_;
+  size_t num_in_flight_ = 0u;
   size_t next_chain_idx_ = 0u;
+  bool evaluating_ = false;
+};
+
+/// Evaluates futures in sequential order, creating each one from `factory(index)` only when the previous one has
+/// finished. Only the future being evaluated is kept alive.
+template<typename T, typename FactoryType>
+class lazy_seq_submitter : public MINICOROS_STD::enable_shared_from_this<lazy_seq_submitter<T, FactoryType>> {
+  using ResultingType = typename vector_result<T>::value_type;
+
+public:
+  lazy_seq_submitter(promise<ResultingType>&& p, size_t count, FactoryType&& factory)
+    : storage_(MINICOROS_STD::move(p)), factory_(MINICOROS_STD::move(factory)), count_(count) {}
+
+  void evaluate() {
+    storage_.resize(count_);
+    evaluate_next_chain();
+  }
+
+  cancellation_state& cancellation() {
+    return storage_.cancellation();
+  }
+
+private:
+  using MINICOROS_STD::enable_shared_from_this<lazy_seq_submitter<T, FactoryType>>::shared_from_this;
+
+  void evaluate_next_chain() {
+    // Futures that finish synchronously call back into here. Leave it to the outermost call to evaluate the next
+    // future so that the stack doesn't grow with the number of futures.
+    if (evaluating_)
+      return;
+
+    evaluating_ = true;
+
+    auto cancellation = cancellation_of(shared_from_this());
+    cancellation_scope scope{cancellation};
+
+    // Stop when failed, or cancelled from further up
+    while (!in_flight_ && next_idx_ < count_ && !cancellation->cancelled()) {
+      const size_t idx = next_idx_++;
+      in_flight_ = true;
+
+      factory_(idx).chain().evaluate_into([shared_this = shared_from_this(), idx] (concrete_result<T>&& result) {
+        shared_this->in_flight_ = false;
+        shared_this->storage_.assign(idx, MINICOROS_STD::move(result));
+        shared_this->evaluate_next_chain();
+      });
+    }
+
+    evaluating_ = false;
+  }
+
+  vector_result<T> storage_;
+  FactoryType factory_;
+  size_t count_;
+  size_t next_idx_ = 0u;
+  bool in_flight_ = false;
+  bool evaluating_ = false;
+};
+
+/// Evaluates `factory(attempt)` for one attempt at a time, and starts another attempt whenever the future returned by
+/// `delay()` resolves before the current attempt has, or as soon as the current attempt fails. Resolves with the first
+/// success (see `success_result`), which cancels the attempts and delays still in flight.
+template<typename T, typename FactoryType, typename DelayType>
+class hedge_submitter : public MINICOROS_STD::enable_shared_from_this<hedge_submitter<T, FactoryType, DelayType>> {
+public:
+  hedge_submitter(promise<T>&& p, size_t max_attempts, FactoryType&& factory, DelayType&& delay)
+    : storage_(MINICOROS_STD::move(p), max_attempts, last_error{})
+    , factory_(MINICOROS_STD::move(factory))
+    , delay_(MINICOROS_STD::move(delay))
+    , max_attempts_(max_attempts) {}
+
+  void evaluate() {
+    launch_next_attempt();
+  }
+
+  cancellation_state& cancellation() {
+    return storage_.cancellation();
+  }
+
+private:
+  using MINICOROS_STD::enable_shared_from_this<hedge_submitter<T, FactoryType, DelayType>>::shared_from_this;
+
+  void launch_next_attempt() {
+    launch_requested_ = true;
+
+    // Attempts and delays that finish synchronously call back into here. Leave it to the outermost call to launch
+    // the next attempt so that the stack doesn't grow with the number of attempts.
+    if (evaluating_)
+      return;
+
+    evaluating_ = true;
+
+    auto cancellation = cancellation_of(shared_from_this());
+    cancellation_scope scope{cancellation};
+
+    // Stop when resolved, or cancelled from further up
+    while (launch_requested_ && next_attempt_ < max_attempts_ && !cancellation->cancelled()) {
+      launch_requested_ = false;
+      const size_t attempt = next_attempt_++;
+
+      factory_(attempt).chain().evaluate_into([shared_this = shared_from_this()] (concrete_result<T>&& result) {
+        const bool failed = !result.success();
+        shared_this->storage_.assign(MINICOROS_STD::move(result));
+
+        if (failed)
+          shared_this->launch_next_attempt();
+      });
+
+      if (launch_requested_ || next_attempt_ == max_attempts_ || cancellation->cancelled())
+        continue;
+
+      // Only hedge if no other attempt has been launched in the meantime (because this one failed)
+      delay_().chain().evaluate_into([shared_this = shared_from_this(), launched = next_attempt_] (concrete_result<void>&& result) {
+        if (result.success() && shared_this->next_attempt_ == launched)
+          shared_this->launch_next_attempt();
+      });
+    }
+
+    evaluating_ = false;
+  }
+
+  success_result<T, last_error> storage_;
+  FactoryType factory_;
+  DelayType delay_;
+  size_t max_attempts_;
+  size_t next_attempt_ = 0u;
+  bool launch_requested_ = false;
+  bool evaluating_ = false;
+};
+
+/// Seed for a `backoff` that differs between instances, threads and processes: the address of the instance, the time
+/// and a per-thread counter, mixed through splitmix64.
+inline uint64_t unique_seed(const void* instance) {
+  static thread_local uint64_t counter = 0;
+
+  uint64_t seed = reinterpret_cast<uintptr_t>(instance)
+    ^ static_cast<uint64_t>(MINICOROS_STD::chrono::steady_clock::now().time_since_epoch().count())
+    ^ (++counter * 0x9e3779b97f4a7c15u)
+    ^ (reinterpret_cast<uintptr_t>(&counter) << 17);
+
+  seed = (seed ^ (seed >> 30)) * 0xbf58476d1ce4e5b9u;
+  seed = (seed ^ (seed >> 27)) * 0x94d049bb133111ebu;
+  seed ^= seed >> 31;
+
+  // xorshift gets stuck at 0
+  return seed ? seed : 1;
+}
+
+/// Computes the delays between the attempts of `mc::retry` according to a `retry_policy`. Jitter comes from an
+/// xorshift generator, which is plenty for spreading out retries.
+class backoff {
+public:
+  explicit backoff(const retry_policy& policy)
+    : next_delay_(static_cast<double>(policy.initial_delay.count()))
+    , max_delay_(static_cast<double>(policy.max_delay.count()))
+    , multiplier_(policy.multiplier)
+    , jitter_(policy.jitter)
+    , state_(policy.seed ? policy.seed : unique_seed(this)) {
+    assert(jitter_ >= 0.0 && jitter_ <= 1.0 && "retry_policy::jitter needs to be between 0 and 1");
+  }
+
+  MINICOROS_STD::chrono::milliseconds next_delay() {
+    const double delay = next_delay_ < max_delay_ ? next_delay_ : max_delay_;
+    next_delay_ = delay * multiplier_;
+
+    return MINICOROS_STD::chrono::milliseconds{static_cast<int64_t>(delay * (1.0 - jitter_ * next_random()))};
+  }
+
+private:
+  /// Uniform in [0, 1)
+  double next_random() {
+    state_ ^= state_ << 13;
+    state_ ^= state_ >> 7;
+    state_ ^= state_ << 17;
+    return static_cast<double>(state_ >> 11) * (1.0 / 9007199254740992.0);
+  }
+
+  double next_delay_;
+  double max_delay_;
+  double multiplier_;
+  double jitter_;
+  uint64_t state_;
+};
+
+/// Evaluates `factory(attempt)` until it succeeds or runs out of attempts, waiting for `sleep(delay)` between the
+/// attempts. Only one attempt is alive at a time, so the chain doesn't get deeper with each attempt.
+template<typename T, typename FactoryType, typename SleepType>
+class retry_submitter : public cancellable, public MINICOROS_STD::enable_shared_from_this<retry_submitter<T, FactoryType, SleepType>> {
+public:
+  retry_submitter(promise<T>&& p, const retry_policy& policy, FactoryType&& factory, SleepType&& sleep)
+    : promise_(MINICOROS_STD::move(p))
+    , factory_(MINICOROS_STD::move(factory))
+    , sleep_(MINICOROS_STD::move(sleep))
+    , backoff_(policy)
+    , max_attempts_(policy.max_attempts) {}
+
+  void evaluate() {
+    attempt_next();
+  }
+
+private:
+  using MINICOROS_STD::enable_shared_from_this<retry_submitter<T, FactoryType, SleepType>>::shared_from_this;
+
+  void attempt_next() {
+    attempt_requested_ = true;
+
+    // Attempts and sleeps that finish synchronously call back into here. Leave it to the outermost call to make the
+    // next attempt so that the stack doesn't grow with the number of attempts.
+    if (evaluating_)
+      return;
+
+    evaluating_ = true;
+
+    auto cancellation = cancellation_of(shared_from_this());
+    cancellation_scope scope{cancellation};
+
+    while (attempt_requested_ && !cancellation->cancelled()) {
+      attempt_requested_ = false;
+      const size_t attempt = next_attempt_++;
+
+      factory_(attempt).chain().evaluate_into([shared_this = shared_from_this()] (concrete_result<T>&& result) {
+        shared_this->on_result(MINICOROS_STD::move(result));
+      });
+    }
+
+    evaluating_ = false;
+  }
+
+  void on_result(concrete_result<T>&& result) {
+    if (result.success() || next_attempt_ == max_attempts_) {
+      promise_(MINICOROS_STD::move(result));
+      return;
+    }
+
+    sleep_(backoff_.next_delay()).chain().evaluate_into([shared_this = shared_from_this()] (concrete_result<void>&& result) {
+      if (auto fail = result.get_failure()) {
+        shared_this->promise_(MINICOROS_STD::move(*fail));
+        return;
+      }
+
+      shared_this->attempt_next();
+    });
+  }
+
+  promise<T> promise_;
+  FactoryType factory_;
+  SleepType sleep_;
+  backoff backoff_;
+  size_t max_attempts_;
+  size_t next_attempt_ = 0u;
+  bool attempt_requested_ = false;
+  bool evaluating_ = false;
+};
+
+/// Condition for loops that only stop when their body says so.
+struct always_true {
+  bool operator ()() const {return true; }
+};
+
+/// Runs `body()` for as long as `condition()` holds and the body doesn't resolve to `false` (for bodies that return
+/// `future<bool>`). Only one iteration is alive at a time, and the iterations are driven from a loop rather than
+/// from each other, so neither memory nor stack grows with the number of iterations.
+template<typename ConditionType, typename BodyType>
+class loop_submitter : public cancellable, public MINICOROS_STD::enable_shared_from_this<loop_submitter<ConditionType, BodyType>> {
+  using T = typename MINICOROS_STD::decay_t<decltype(MINICOROS_STD::declval<BodyType&>()())>::type;
+  static_assert(MINICOROS_STD::is_void_v<T> || MINICOROS_STD::is_same_v<T, bool>, "Loop bodies need to return future<void> or future<bool>");
+
+public:
+  loop_submitter(promise<void>&& p, ConditionType&& condition, BodyType&& body)
+    : promise_(MINICOROS_STD::move(p))
+    , condition_(MINICOROS_STD::move(condition))
+    , body_(MINICOROS_STD::move(body)) {}
+
+  void evaluate() {
+    iterate();
+  }
+
+private:
+  using MINICOROS_STD::enable_shared_from_this<loop_submitter<ConditionType, BodyType>>::shared_from_this;
+
+  void iterate() {
+    iteration_requested_ = true;
+
+    // Bodies that finish synchronously call back into here. Leave it to the outermost call to run the next
+    // iteration so that the stack doesn't grow with the number of iterations.
+    if (evaluating_)
+      return;
+
+    evaluating_ = true;
+
+    auto cancellation = cancellation_of(shared_from_this());
+    cancellation_scope scope{cancellation};
+
+    while (iteration_requested_ && !cancellation->cancelled()) {
+      iteration_requested_ = false;
+
+      if (!condition_()) {
+        promise_({});
+        break;
+      }
+
+      body_().chain().evaluate_into([shared_this = shared_from_this()] (concrete_result<T>&& result) {
+        shared_this->on_result(MINICOROS_STD::move(result));
+      });
+    }
+
+    evaluating_ = false;
+  }
+
+  void on_result(concrete_result<T>&& result) {
+    if (auto fail = result.get_failure()) {
+      promise_(MINICOROS_STD::move(*fail));
+      return;
+    }
+
+    if constexpr (!MINICOROS_STD::is_void_v<T>) {
+      if (!*result.get_value()) {
+        promise_({});
+        return;
+      }
+    }
+
+    iterate();
+  }
+
+  promise<void> promise_;
+  ConditionType condition_;
+  BodyType body_;
+  bool iteration_requested_ = false;
+  bool evaluating_ = false;
 };
 
 } // mc::detail
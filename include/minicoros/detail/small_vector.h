@@ -0,0 +1,145 @@
+/// Copyright (C) 2022 Electronic Arts Inc.  All rights reserved.
+
+#ifndef MINICOROS_DETAIL_SMALL_VECTOR_H_
+#define MINICOROS_DETAIL_SMALL_VECTOR_H_
+
+#ifdef MINICOROS_CUSTOM_INCLUDE
+  #include MINICOROS_CUSTOM_INCLUDE
+#endif
+
+#include <minicoros/allocator.h>
+
+/// Number of elements the combinators (`when_all`, `when_any`, ...) store inline before falling back to the heap.
+#ifndef MINICOROS_SMALL_VECTOR_SIZE
+  #define MINICOROS_SMALL_VECTOR_SIZE 8
+#endif
+
+#ifdef MINICOROS_USE_EASTL
+  #include <eastl/fixed_vector.h>
+
+  #ifndef MINICOROS_STD
+    #define MINICOROS_STD eastl
+  #endif
+#else
+  #include <cstddef>
+  #include <new>
+  #include <utility>
+
+  #ifndef MINICOROS_STD
+    #define MINICOROS_STD std
+  #endif
+#endif
+
+namespace mc::detail {
+
+#ifdef MINICOROS_USE_EASTL
+
+template<typename T, size_t InlineCapacity>
+using small_vector = eastl::fixed_vector<T, InlineCapacity, true, resource_allocator>;
+
+#else
+
+/// Vector that stores up to `InlineCapacity` elements inline and only allocates (from the memory resource that was
+/// current when it was created) when growing beyond that. Only implements what the combinators need.
+template<typename T, size_t InlineCapacity>
+class small_vector {
+  static_assert(InlineCapacity > 0, "small_vector needs room for at least one inline element");
+
+public:
+  small_vector() = default;
+
+  small_vector(const small_vector& other) : resource_(other.resource_) {
+    reserve(other.size_);
+
+    for (const T& value : other)
+      push_back(T{value});
+  }
+
+  small_vector(small_vector&& other) noexcept : resource_(other.resource_) {
+    if (other.heap_) {
+      heap_ = other.heap_;
+      capacity_ = other.capacity_;
+      size_ = other.size_;
+      other.heap_ = nullptr;
+      other.capacity_ = InlineCapacity;
+      other.size_ = 0;
+    }
+    else {
+      for (T& value : other)
+        push_back(MINICOROS_STD::move(value));
+
+      other.clear();
+    }
+  }
+
+  small_vector& operator =(const small_vector&) = delete;
+  small_vector& operator =(small_vector&&) = delete;
+
+  ~small_vector() {
+    clear();
+    deallocate_heap();
+  }
+
+  void reserve(size_t new_capacity) {
+    if (new_capacity <= capacity_)
+      return;
+
+    T* new_data = static_cast<T*>(allocate_bytes(resource_, new_capacity * sizeof(T), alignof(T)));
+
+    for (size_t i = 0; i < size_; ++i) {
+      new (new_data + i) T(MINICOROS_STD::move(data()[i]));
+      data()[i].~T();
+    }
+
+    deallocate_heap();
+    heap_ = new_data;
+    capacity_ = new_capacity;
+  }
+
+  void push_back(T&& value) {
+    if (size_ == capacity_)
+      reserve(capacity_ * 2);
+
+    new (data() + size_) T(MINICOROS_STD::move(value));
+    ++size_;
+  }
+
+  void clear() {
+    for (T& value : *this)
+      value.~T();
+
+    size_ = 0;
+  }
+
+  T& operator [](size_t index) {return data()[index]; }
+  const T& operator [](size_t index) const {return data()[index]; }
+
+  T* begin() {return data(); }
+  T* end() {return data() + size_; }
+  const T* begin() const {return data(); }
+  const T* end() const {return data() + size_; }
+
+  size_t size() const {return size_; }
+  bool empty() const {return size_ == 0; }
+
+private:
+  void deallocate_heap() {
+    if (heap_)
+      deallocate_bytes(resource_, heap_, capacity_ * sizeof(T), alignof(T));
+  }
+
+  T* data() {return heap_ ? heap_ : reinterpret_cast<T*>(inline_storage_); }
+  const T* data() const {return heap_ ? heap_ : reinterpret_cast<const T*>(inline_storage_); }
+
+  alignas(T) unsigned char inline_storage_[sizeof(T) * InlineCapacity];
+  T* heap_ = nullptr;
+  size_t size_ = 0;
+  size_t capacity_ = InlineCapacity;
+  memory_resource* resource_ = current_memory_resource();
+};
+
+#endif
+
+} // mc::detail
+
+#endif // MINICOROS_DETAIL_SMALL_VECTOR_H_
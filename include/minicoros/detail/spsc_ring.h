@@ -0,0 +1,97 @@
+/// Copyright (C) 2022 Electronic Arts Inc.  All rights reserved.
+
+#ifndef MINICOROS_DETAIL_SPSC_RING_H_
+#define MINICOROS_DETAIL_SPSC_RING_H_
+
+#ifdef MINICOROS_CUSTOM_INCLUDE
+  #include MINICOROS_CUSTOM_INCLUDE
+#endif
+
+#ifdef MINICOROS_USE_EASTL
+  #include <eastl/atomic.h>
+  #include <eastl/utility.h>
+  #include <eastl/vector.h>
+  #include <cassert>
+
+  #ifndef MINICOROS_STD
+    #define MINICOROS_STD eastl
+  #endif
+#else
+  #include <atomic>
+  #include <utility>
+  #include <vector>
+  #include <cassert>
+
+  #ifndef MINICOROS_STD
+    #define MINICOROS_STD std
+  #endif
+#endif
+
+namespace mc::detail {
+
+/// Bounded lock-free single-producer, single-consumer ring. The producer and the consumer each keep a cached copy of
+/// the other side's index, so they only touch each other's cache line when the ring looks full or empty.
+template<typename T>
+class spsc_ring {
+public:
+  /// `capacity` has to be a power of two.
+  explicit spsc_ring(size_t capacity) : slots_(capacity), mask_(capacity - 1) {
+    assert(capacity > 0 && (capacity & (capacity - 1)) == 0 && "spsc_ring needs a power-of-two capacity");
+  }
+
+  spsc_ring(const spsc_ring&) = delete;
+  spsc_ring& operator =(const spsc_ring&) = delete;
+
+  /// Producer only. Returns false, leaving `value` untouched, if the ring is full.
+  bool try_push(T&& value) {
+    const size_t tail = tail_.load(MINICOROS_STD::memory_order_relaxed);
+
+    if (tail - cached_head_ == slots_.size()) {
+      cached_head_ = head_.load(MINICOROS_STD::memory_order_acquire);
+
+      if (tail - cached_head_ == slots_.size())
+        return false;
+    }
+
+    slots_[tail & mask_] = MINICOROS_STD::move(value);
+    tail_.store(tail + 1, MINICOROS_STD::memory_order_release);
+    return true;
+  }
+
+  /// Consumer only. Returns false if the ring is empty.
+  bool try_pop(T& out) {
+    const size_t head = head_.load(MINICOROS_STD::memory_order_relaxed);
+
+    if (head == cached_tail_) {
+      cached_tail_ = tail_.load(MINICOROS_STD::memory_order_acquire);
+
+      if (head == cached_tail_)
+        return false;
+    }
+
+    out = MINICOROS_STD::move(slots_[head & mask_]);
+    head_.store(head + 1, MINICOROS_STD::memory_order_release);
+    return true;
+  }
+
+  /// Any thread, but only a hint while the producer or consumer is active.
+  bool empty() const {
+    return head_.load(MINICOROS_STD::memory_order_acquire) == tail_.load(MINICOROS_STD::memory_order_acquire);
+  }
+
+private:
+  static constexpr size_t cache_line_size = 64;
+
+  MINICOROS_STD::vector<T> slots_;
+  size_t mask_;
+
+  alignas(cache_line_size) MINICOROS_STD::atomic<size_t> head_{0};
+  size_t cached_tail_ = 0;
+
+  alignas(cache_line_size) MINICOROS_STD::atomic<size_t> tail_{0};
+  size_t cached_head_ = 0;
+};
+
+} // mc::detail
+
+#endif // MINICOROS_DETAIL_SPSC_RING_H_
@@ -0,0 +1,97 @@
+/// Copyright (C) 2022 Electronic Arts Inc.  All rights reserved.
+
+#ifndef MINICOROS_DETAIL_UNIQUE_WORK_H_
+#define MINICOROS_DETAIL_UNIQUE_WORK_H_
+
+#ifdef MINICOROS_CUSTOM_INCLUDE
+  #include MINICOROS_CUSTOM_INCLUDE
+#endif
+
+#ifdef MINICOROS_USE_EASTL
+  #include <eastl/unique_ptr.h>
+  #include <eastl/type_traits.h>
+  #include <eastl/utility.h>
+
+  #ifndef MINICOROS_STD
+    #define MINICOROS_STD eastl
+  #endif
+#else
+  #include <memory>
+  #include <type_traits>
+  #include <utility>
+
+  #ifndef MINICOROS_STD
+    #define MINICOROS_STD std
+  #endif
+#endif
+
+namespace mc::detail {
+
+/// Type-erased work item for the executors. Unlike `MINICOROS_FUNCTION_TYPE`, it doesn't require the work to be
+/// copyable, since the work that `future::enqueue` hands over owns the result it passes on.
+class unique_work {
+public:
+  unique_work() = default;
+
+  template<typename WorkType, typename = MINICOROS_STD::enable_if_t<!MINICOROS_STD::is_same_v<MINICOROS_STD::decay_t<WorkType>, unique_work>>>
+  unique_work(WorkType&& work) : impl_(new model<MINICOROS_STD::decay_t<WorkType>>(MINICOROS_STD::forward<WorkType>(work))) {}
+
+  unique_work(unique_work&&) noexcept = default;
+  unique_work& operator =(unique_work&&) noexcept = default;
+
+  void operator ()() {
+    impl_->run();
+  }
+
+  explicit operator bool() const {
+    return impl_ != nullptr;
+  }
+
+private:
+  struct concept_base {
+    virtual ~concept_base() = default;
+    virtual void run() = 0;
+  };
+
+  template<typename WorkType>
+  struct model : concept_base {
+    explicit model(WorkType&& w) : work(MINICOROS_STD::move(w)) {}
+    explicit model(const WorkType& w) : work(w) {}
+
+    void run() override {
+      work();
+    }
+
+    WorkType work;
+  };
+
+  MINICOROS_STD::unique_ptr<concept_base> impl_;
+};
+
+/// Work that can be linked into an intrusive queue, so that queuing it doesn't allocate anything on top of the work
+/// itself. Created with `make_work_node`, and deleted by whoever runs it.
+struct work_node {
+  virtual ~work_node() = default;
+  virtual void run() = 0;
+
+  work_node* next = nullptr;
+};
+
+template<typename WorkType>
+work_node* make_work_node(WorkType&& work) {
+  struct node : work_node {
+    explicit node(WorkType&& w) : work(MINICOROS_STD::forward<WorkType>(w)) {}
+
+    void run() override {
+      work();
+    }
+
+    MINICOROS_STD::decay_t<WorkType> work;
+  };
+
+  return new node(MINICOROS_STD::forward<WorkType>(work));
+}
+
+} // mc::detail
+
+#endif // MINICOROS_DETAIL_UNIQUE_WORK_H_
@@ -0,0 +1,191 @@
+/// Copyright (C) 2022 Electronic Arts Inc.  All rights reserved.
+
+#ifndef MINICOROS_FRAME_EXECUTOR_H_
+#define MINICOROS_FRAME_EXECUTOR_H_
+
+#ifdef MINICOROS_CUSTOM_INCLUDE
+  #include MINICOROS_CUSTOM_INCLUDE
+#endif
+
+#include <minicoros/detail/mpsc_queue.h>
+
+#ifdef MINICOROS_USE_EASTL
+  #include <eastl/chrono.h>
+  #include <eastl/deque.h>
+  #include <eastl/type_traits.h>
+  #include <eastl/utility.h>
+  #include <eastl/vector.h>
+
+  #ifndef MINICOROS_STD
+    #define MINICOROS_STD eastl
+  #endif
+#else
+  #include <chrono>
+  #include <deque>
+  #include <type_traits>
+  #include <utility>
+  #include <vector>
+
+  #ifndef MINICOROS_STD
+    #define MINICOROS_STD std
+  #endif
+#endif
+
+namespace mc {
+
+/// Executor for work that runs on the main thread of a game, within a time budget per frame. Any thread can give it
+/// work; the main thread calls `run_for(budget)` once per frame, which runs queued work in order until the budget is
+/// used up and leaves the rest for the next frame:
+///
+/// ```cpp
+/// mc::frame_executor<> frame;
+///
+/// load_asset(path)
+///   .enqueue(frame.with_cost(2ms)) // Optional estimate of how long the continuation takes
+///   .then([](asset&& a) {world.spawn(a); });
+///
+/// while (running) {
+///   auto stats = frame.run_for(4ms);
+///   ...
+/// }
+/// ```
+///
+/// With `skip_over_budget` set, work with an estimate that doesn't fit in what's left of the budget is passed over in
+/// favor of later work that does (the first work of each frame always runs, so nothing is passed over forever).
+/// `ClockType` is a `std::chrono`-style clock, and can be swapped out for testing. The executor has to outlive the
+/// work given to it; work that is still queued when it's destroyed is dropped without running.
+template<typename ClockType = MINICOROS_STD::chrono::steady_clock>
+class frame_executor {
+public:
+  using duration = typename ClockType::duration;
+
+  struct stats {
+    /// Work run during the frame
+    size_t num_run = 0;
+    /// Work left for the next frame, including work given to the executor during the frame
+    size_t num_deferred = 0;
+    /// Time spent running work
+    duration elapsed = duration::zero();
+  };
+
+  /// Executor that gives work to a `frame_executor` along with an estimate of how long it takes.
+  class estimated {
+  public:
+    estimated(frame_executor& executor, duration cost) : executor_(&executor), cost_(cost) {}
+
+    template<typename WorkType>
+    void operator ()(WorkType&& work) const {
+      executor_->post(MINICOROS_STD::forward<WorkType>(work), cost_);
+    }
+
+  private:
+    frame_executor* executor_;
+    duration cost_;
+  };
+
+  explicit frame_executor(bool skip_over_budget = false) : skip_over_budget_(skip_over_budget) {}
+
+  frame_executor(const frame_executor&) = delete;
+  frame_executor& operator =(const frame_executor&) = delete;
+
+  ~frame_executor() {
+    take_incoming();
+
+    for (item* i : pending_)
+      delete i;
+  }
+
+  /// Any thread.
+  template<typename WorkType>
+  void operator ()(WorkType&& work) {
+    post(MINICOROS_STD::forward<WorkType>(work), duration::zero());
+  }
+
+  /// Any thread.
+  estimated with_cost(duration cost) {
+    return estimated{*this, cost};
+  }
+
+  /// Main thread only. Runs queued work until `budget` is used up.
+  stats run_for(duration budget) {
+    const auto start = ClockType::now();
+    stats result;
+
+    take_incoming();
+
+    while (!pending_.empty()) {
+      const duration elapsed = ClockType::now() - start;
+
+      if (elapsed >= budget)
+        break;
+
+      item* next = pending_.front();
+      pending_.pop_front();
+
+      if (skip_over_budget_ && result.num_run > 0 && elapsed + next->cost > budget) {
+        skipped_.push_back(next);
+        continue;
+      }
+
+      next->run();
+      delete next;
+      ++result.num_run;
+    }
+
+    // Work that was passed over keeps its place ahead of the work that wasn't looked at
+    pending_.insert(pending_.begin(), skipped_.begin(), skipped_.end());
+    skipped_.clear();
+
+    // Work given to the executor by the work that just ran waits for the next frame
+    take_incoming();
+
+    result.num_deferred = pending_.size();
+    result.elapsed = ClockType::now() - start;
+    return result;
+  }
+
+private:
+  struct item {
+    virtual ~item() = default;
+    virtual void run() = 0;
+
+    item* next = nullptr;
+    duration cost = duration::zero();
+  };
+
+  template<typename WorkType>
+  void post(WorkType&& work, duration cost) {
+    struct typed_item : item {
+      explicit typed_item(WorkType&& w) : work(MINICOROS_STD::forward<WorkType>(w)) {}
+
+      void run() override {
+        work();
+      }
+
+      MINICOROS_STD::decay_t<WorkType> work;
+    };
+
+    item* i = new typed_item(MINICOROS_STD::forward<WorkType>(work));
+    i->cost = cost;
+    incoming_.push(i);
+  }
+
+  void take_incoming() {
+    for (item* i = incoming_.take_all(); i;) {
+      item* next = i->next;
+      pending_.push_back(i);
+      i = next;
+    }
+  }
+
+  detail::intrusive_mpsc_queue<item> incoming_;
+  /// Work carried over from earlier frames, in order; only touched by the main thread
+  MINICOROS_STD::deque<item*> pending_;
+  /// Work passed over during the current frame, in order
+  MINICOROS_STD::vector<item*> skipped_;
+  bool skip_over_budget_;
+};
+
+} // mc
+
+#endif // MINICOROS_FRAME_EXECUTOR_H_
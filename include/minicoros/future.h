@@ -17,6 +17,7 @@
   #include <eastl/memory.h>
   #include <eastl/shared_ptr.h>
   #include <eastl/utility.h>
+  #include <eastl/atomic.h>
 
   #ifndef MINICOROS_STD
     #define MINICOROS_STD eastl
@@ -26,6 +27,7 @@
   #include <variant>
   #include <memory>
   #include <optional>
+  #include <atomic>
 
   #ifndef MINICOROS_STD
     #define MINICOROS_STD std
@@ -37,8 +39,82 @@ namespace mc {
 template<typename... Ts>
 class result;
 
+template<typename... Ts>
+class future;
+
 namespace detail {
 
+/// Calls through to an executor that can't be copied, see `future::enqueue`.
+template<typename ExecutorType>
+class executor_ref {
+public:
+  explicit executor_ref(ExecutorType& executor) : executor_(&executor) {}
+
+  template<typename WorkType>
+  void operator ()(WorkType&& work) const {
+    (*executor_)(MINICOROS_STD::forward<WorkType>(work));
+  }
+
+  template<typename E = ExecutorType>
+  auto running_in_this_thread() const -> decltype(MINICOROS_STD::declval<const E&>().running_in_this_thread()) {
+    return executor_->running_in_this_thread();
+  }
+
+private:
+  ExecutorType* executor_;
+};
+
+template<typename ExecutorType>
+auto capture_executor(ExecutorType&& executor) {
+  using StoredType = MINICOROS_STD::decay_t<ExecutorType>;
+
+  if constexpr (MINICOROS_STD::is_lvalue_reference_v<ExecutorType> && !MINICOROS_STD::is_copy_constructible_v<StoredType>)
+    return executor_ref<StoredType>{executor};
+  else
+    return StoredType{MINICOROS_STD::forward<ExecutorType>(executor)};
+}
+
+template<typename ExecutorType, typename = void>
+struct has_running_in_this_thread : public MINICOROS_STD::false_type {};
+
+template<typename ExecutorType>
+struct has_running_in_this_thread<ExecutorType, MINICOROS_STD::void_t<decltype(MINICOROS_STD::declval<const ExecutorType&>().running_in_this_thread())>> : public MINICOROS_STD::true_type {};
+
+/// Continuations that `future::enqueue` is running inline on the current thread, nested inside each other.
+inline size_t& inline_depth() {
+  static thread_local size_t depth = 0;
+  return depth;
+}
+
+/// Whether `future::enqueue` can skip handing work to `executor` and run it right away instead.
+template<typename ExecutorType>
+bool can_run_inline(const ExecutorType& executor) {
+  if constexpr (has_running_in_this_thread<ExecutorType>::value)
+    return inline_depth() < MINICOROS_MAX_INLINE_DEPTH && executor.running_in_this_thread();
+  else
+    return false;
+}
+
+template<typename T>
+struct is_future : public MINICOROS_STD::false_type {};
+
+template<typename... Ts>
+struct is_future<mc::future<Ts...>> : public MINICOROS_STD::true_type {};
+
+template<typename T>
+constexpr bool is_future_v = is_future<T>::value;
+
+/// Returns the futures a (possibly composed) future consists of.
+template<typename T>
+MINICOROS_STD::tuple<future<T>> operands_of(future<T>&& fut);
+
+template<typename T1, typename T2, typename... Ts>
+MINICOROS_STD::tuple<future<T1>, future<T2>, future<Ts>...> operands_of(future<T1, T2, Ts...>&& fut);
+
+/// Joins the given futures using a single shared state. See `future<Ts...>`.
+template<typename... Ts>
+future<typename join_result<Ts...>::value_type> join_futures(MINICOROS_STD::tuple<future<Ts>...>&& futures);
+
 template<typename... Ts>
 struct is_result : public MINICOROS_STD::false_type {};
 
@@ -135,7 +211,7 @@ auto resulting_type_from_failure_callback(CallbackType&& callback) -> typename r
 /// on top of the continuation chain to make it easier to use. It also has support for exception-like
 /// error handling.
 template<typename T>
-class [[nodiscard]] future {
+class [[nodiscard]] future<T> {
 public:
   static_assert(MINICOROS_STD::is_void_v<T> || MINICOROS_STD::is_copy_constructible_v<T>, "Type must be copy-constructible"); // TODO: unfortunately we need copy-constructors. Get rid of that (might need move-only std::function)
   static_assert(MINICOROS_STD::is_void_v<T> || MINICOROS_STD::is_move_constructible_v<T>, "Type must be move-constructible");
@@ -272,40 +348,44 @@ public:
   /// An executor is something that has an `operator ()(WorkType&&)` where WorkType is a move-only object
   /// that has an `operator ()()`.
   /// Typically used for enqueuing evaluation on a work queue.
+  /// Executors are taken by copy, apart from executors that can't be copied (like `thread_pool`), which are taken by
+  /// reference and have to outlive the future.
+  /// Executors that have a `bool running_in_this_thread() const` are skipped when it returns true: the downstream
+  /// callbacks run right away instead, so that consecutive `enqueue`s onto the same executor only hop once. To keep
+  /// the stack in check, at most `MINICOROS_MAX_INLINE_DEPTH` of them run nested inside each other.
   template<typename ExecutorType>
   future<T> enqueue(ExecutorType&& executor) && {
-    // Take the executor by copy
-    return MINICOROS_STD::move(chain_).template transform<concrete_result<T>>([executor](concrete_result<T>&& value, promise<T>&& promise) mutable {
+    return MINICOROS_STD::move(chain_).template transform<concrete_result<T>>([executor = detail::capture_executor(MINICOROS_STD::forward<ExecutorType>(executor))](concrete_result<T>&& value, promise<T>&& promise) mutable {
+      if (detail::can_run_inline(executor)) {
+        ++detail::inline_depth();
+        MINICOROS_STD::move(promise)(MINICOROS_STD::move(value));
+        --detail::inline_depth();
+        return;
+      }
+
       executor([value = MINICOROS_STD::move(value), promise = MINICOROS_STD::move(promise)] () mutable {
         MINICOROS_STD::move(promise)(MINICOROS_STD::move(value));
       });
     });
   }
 
-  template<typename RhsResultType>
-  auto operator &&(future<RhsResultType>&& rhs) && {
-    using ResultingTupleType = typename detail::tuple_result<T, RhsResultType>::value_type;
-
-    return future<ResultingTupleType>([lhs_chain = MINICOROS_STD::move(*this).chain(), rhs_chain = MINICOROS_STD::move(rhs).chain()](promise<ResultingTupleType>&& p) mutable {
-      auto result_builder = MINICOROS_STD::make_shared<detail::tuple_result<T, RhsResultType>>(MINICOROS_STD::move(p));
-
-      MINICOROS_STD::move(lhs_chain).evaluate_into([result_builder] (concrete_result<T>&& result) {
-        result_builder->assign_lhs(MINICOROS_STD::move(result));
-      });
-
-      MINICOROS_STD::move(rhs_chain).evaluate_into([result_builder] (concrete_result<RhsResultType>&& result) {
-        result_builder->assign_rhs(MINICOROS_STD::move(result));
-      });
-    });
+  /// Composes this future with `rhs`. Both futures are evaluated when the composition is, and the composition
+  /// resolves to all of their values (see `future<Ts...>`), or to the first failure, which cancels the other future.
+  template<typename... RhsTypes>
+  future<T, RhsTypes...> operator &&(future<RhsTypes...>&& rhs) && {
+    return future<T, RhsTypes...>{MINICOROS_STD::tuple_cat(MINICOROS_STD::tuple<future<T>>{MINICOROS_STD::move(*this)}, detail::operands_of(MINICOROS_STD::move(rhs)))};
   }
 
   /// Returns the first result from any of the futures. If the first result is a failure,
-  /// `||` will return that failure.
+  /// `||` will return that failure. The other future is cancelled: the handlers it hasn't run yet are skipped, see
+  /// `when_any`.
   future<T> operator ||(future<T>&& rhs) && {
     // Unwrap the chains from their future overcoats. Futures aren't copy-constructible, but the chains are. Remove
     // this when we have move-only std::function.
-    return future<T>([lhs_chain = MINICOROS_STD::move(*this).chain(), rhs_chain = MINICOROS_STD::move(rhs).chain()](promise<T>&& p) mutable {
-      auto result_builder = MINICOROS_STD::make_shared<detail::any_result<T>>(MINICOROS_STD::move(p));
+    return future<T>([resource = detail::current_memory_resource(), lhs_chain = MINICOROS_STD::move(*this).chain(), rhs_chain = MINICOROS_STD::move(rhs).chain()](promise<T>&& p) mutable {
+      auto result_builder = detail::allocate_state<detail::any_result<T>>(resource, MINICOROS_STD::move(p));
+      auto cancellation = detail::cancellation_of(result_builder);
+      detail::cancellation_scope scope{cancellation};
 
       MINICOROS_STD::move(lhs_chain).evaluate_into([result_builder] (concrete_result<T>&& result) {
         result_builder->assign(MINICOROS_STD::move(result));
@@ -330,6 +410,139 @@ private:
   continuation_chain<concrete_result<T>> chain_;
 };
 
+/// A composition of futures, created using `&&`. The composed futures are kept side by side (flat) and are joined
+/// using a single shared state when the composition is used. The values are handed to the next callback as separate
+/// arguments:
+///
+/// ```cpp
+/// (make_successful_future<int>(1) && make_successful_future<void>() && make_successful_future<std::string>("a"))
+///   .then([](int i, std::string s) {
+///     ...
+///   });
+/// ```
+///
+/// A composition behaves like, and converts to, a `future<type>` where `type` is the flattened tuple of all the
+/// values. `void` values are left out and a single value isn't wrapped in a tuple.
+template<typename... Ts>
+class [[nodiscard]] future {
+public:
+  using type = typename detail::join_result<Ts...>::value_type;
+
+  explicit future(MINICOROS_STD::tuple<future<Ts>...>&& futures) : futures_(MINICOROS_STD::move(futures)) {}
+
+  future(const future&) = delete;
+  future& operator =(const future&) = delete;
+
+  future(future&& other) : futures_(MINICOROS_STD::move(other.futures_)) {}
+  future& operator =(future&& other) {futures_ = MINICOROS_STD::move(other.futures_); return *this; }
+
+  operator future<type>() && {
+    return MINICOROS_STD::move(*this).join();
+  }
+
+  /// Joins the composed futures into a single future.
+  future<type> join() && {
+    return detail::join_futures(MINICOROS_STD::move(futures_));
+  }
+
+  template<typename CallbackType>
+  auto then(CallbackType&& callback) && {
+    return MINICOROS_STD::move(*this).join().then(MINICOROS_STD::forward<CallbackType>(callback));
+  }
+
+  template<typename CallbackType>
+  auto fail(CallbackType&& callback) && {
+    return MINICOROS_STD::move(*this).join().fail(MINICOROS_STD::forward<CallbackType>(callback));
+  }
+
+  template<typename CallbackType>
+  auto map(CallbackType&& callback) && {
+    return MINICOROS_STD::move(*this).join().map(MINICOROS_STD::forward<CallbackType>(callback));
+  }
+
+  template<typename CallbackType>
+  auto finally(CallbackType&& callback) && {
+    return MINICOROS_STD::move(*this).join().finally(MINICOROS_STD::forward<CallbackType>(callback));
+  }
+
+  template<typename CallbackType>
+  void done(CallbackType&& callback) && {
+    MINICOROS_STD::move(*this).join().done(MINICOROS_STD::forward<CallbackType>(callback));
+  }
+
+  void ignore_result() && {
+    MINICOROS_STD::move(*this).join().ignore_result();
+  }
+
+  template<typename ExecutorType>
+  future<type> enqueue(ExecutorType&& executor) && {
+    return MINICOROS_STD::move(*this).join().enqueue(MINICOROS_STD::forward<ExecutorType>(executor));
+  }
+
+  /// Appends more futures to this composition, without nesting.
+  template<typename... RhsTypes>
+  future<Ts..., RhsTypes...> operator &&(future<RhsTypes...>&& rhs) && {
+    return future<Ts..., RhsTypes...>{MINICOROS_STD::tuple_cat(MINICOROS_STD::move(futures_), detail::operands_of(MINICOROS_STD::move(rhs)))};
+  }
+
+  future<type> operator ||(future<type>&& rhs) && {
+    return MINICOROS_STD::move(*this).join() || MINICOROS_STD::move(rhs);
+  }
+
+  continuation_chain<concrete_result<type>> chain() && {
+    return MINICOROS_STD::move(*this).join().chain();
+  }
+
+  /// Hands out the composed futures.
+  MINICOROS_STD::tuple<future<Ts>...>&& operands() && {
+    return MINICOROS_STD::move(futures_);
+  }
+
+  /// Stops the composed futures from getting evaluated on destruction.
+  void freeze() {
+    MINICOROS_STD::apply([](future<Ts>&... futures) {(futures.freeze(), ...); }, futures_);
+  }
+
+private:
+  MINICOROS_STD::tuple<future<Ts>...> futures_;
+};
+
+namespace detail {
+
+template<typename T>
+MINICOROS_STD::tuple<future<T>> operands_of(future<T>&& fut) {
+  return MINICOROS_STD::tuple<future<T>>{MINICOROS_STD::move(fut)};
+}
+
+template<typename T1, typename T2, typename... Ts>
+MINICOROS_STD::tuple<future<T1>, future<T2>, future<Ts>...> operands_of(future<T1, T2, Ts...>&& fut) {
+  return MINICOROS_STD::move(fut).operands();
+}
+
+template<typename... Ts>
+future<typename join_result<Ts...>::value_type> join_futures(MINICOROS_STD::tuple<future<Ts>...>&& futures) {
+  using ResultType = typename join_result<Ts...>::value_type;
+
+  // Unwrap the chains from their future overcoats. Futures aren't copy-constructible, but the chains are. Remove
+  // this when we have move-only std::function.
+  auto chains = MINICOROS_STD::apply([](future<Ts>&... futs) {
+    return MINICOROS_STD::make_tuple(MINICOROS_STD::move(futs).chain()...);
+  }, futures);
+
+  return future<ResultType>([resource = current_memory_resource(), chains = MINICOROS_STD::move(chains)](promise<ResultType>&& p) mutable {
+    if constexpr (sizeof...(Ts) == 0) {
+      (void)resource;
+      p(concrete_result<ResultType>{});
+    }
+    else {
+      auto result_builder = allocate_state<join_result<Ts...>>(resource, MINICOROS_STD::move(p));
+      evaluate_into_indexed(MINICOROS_STD::move(chains), result_builder, MINICOROS_STD::index_sequence_for<Ts...>());
+    }
+  });
+}
+
+} // detail
+
 template<typename T>
 future<T> make_successful_future(T&& value) {
   return future<T>([value = MINICOROS_STD::forward<T>(value)](promise<T>&& p) mutable {p(MINICOROS_STD::forward<T>(value)); });
@@ -355,38 +568,57 @@ future<T> make_failed_future(MINICOROS_ERROR_TYPE&& error) {
   return future<T>([error = MINICOROS_STD::move(error)](promise<T>&& p) mutable {p(failure{MINICOROS_STD::move(error)}); });
 }
 
+/// Rendezvous between the promise returned by `make_future` and the future's own promise. The two may be handed over
+/// on different threads: a single atomic state word decides which side arrives last, and that side passes the value
+/// on. The side that arrives first only publishes what it has. Repeated resolves are ignored.
 template<typename T>
 class persistent_promise
 {
 public:
   void resolve(concrete_result<T> value) {
-    if (stored_promise_) {
-      MINICOROS_STD::move(stored_promise_)(MINICOROS_STD::move(value));
+    // Only the first resolve gets to store a value
+    if (state_.fetch_or(value_claimed, MINICOROS_STD::memory_order_relaxed) & value_claimed)
+      return;
+
+    stored_value_.emplace(MINICOROS_STD::move(value));
+
+    if (state_.fetch_or(has_value, MINICOROS_STD::memory_order_acq_rel) & has_promise) {
+      MINICOROS_STD::move(stored_promise_)(MINICOROS_STD::move(*stored_value_));
       stored_promise_ = nullptr;
-    }
-    else {
-      stored_value_.emplace(MINICOROS_STD::move(value));
+      stored_value_.reset();
     }
   }
 
   void imbue(promise<T> p) {
-    if (stored_value_) {
-      p(MINICOROS_STD::move(*stored_value_));
-      stored_value_.reset();
-    }
-    else {
+    // Already resolved: no need to publish the promise
+    if (!(state_.load(MINICOROS_STD::memory_order_acquire) & has_value)) {
       stored_promise_ = MINICOROS_STD::move(p);
+
+      if (!(state_.fetch_or(has_promise, MINICOROS_STD::memory_order_acq_rel) & has_value))
+        return;
+
+      p = MINICOROS_STD::move(stored_promise_);
+      stored_promise_ = nullptr;
     }
+
+    p(MINICOROS_STD::move(*stored_value_));
+    stored_value_.reset();
   }
 
 private:
+  static constexpr unsigned value_claimed = 1u;
+  static constexpr unsigned has_value = 2u;
+  static constexpr unsigned has_promise = 4u;
+
+  MINICOROS_STD::atomic<unsigned> state_{0u};
   MINICOROS_STD::optional<concrete_result<T>> stored_value_;
   promise<T> stored_promise_;
 };
 
 /// An easier way for creating a future so that you get a promise at creation and don't have to wait for the lambda
 /// in the constructor to get called. This function hides the lazy evaluation of minicoros, and in that way, avoids some
-/// common mistakes. The promise can be resolved at any time.
+/// common mistakes. The promise can be resolved at any time, also from another thread than the one evaluating the
+/// future; only the first resolve counts.
 ///
 /// Example:
 /// ```
@@ -435,6 +667,9 @@ private:
 public:
   result(future<type>&& coro) : value_(MINICOROS_STD::move(coro)) {}
 
+  template<typename T1, typename T2, typename... Us>
+  result(future<T1, T2, Us...>&& coros) : value_(future<type>{MINICOROS_STD::move(coros)}) {}
+
   template<typename OtherType>
   result(OtherType&& value) : value_(StoredType(MINICOROS_STD::move(value))) {}
 
@@ -465,6 +700,9 @@ public:
 
   result() : value_(success_t{}) {}
   result(future<void>&& coro) : value_(MINICOROS_STD::move(coro)) {}
+
+  template<typename T1, typename T2, typename... Us>
+  result(future<T1, T2, Us...>&& coros) : value_(future<void>{MINICOROS_STD::move(coros)}) {}
   result(failure&& f) : value_(MINICOROS_STD::move(f)) {}
 
   void resolve_promise(promise<void>&& promise) {
@@ -15,6 +15,7 @@
   #include <eastl/tuple.h>
   #include <eastl/memory.h>
   #include <eastl/shared_ptr.h>
+  #include <eastl/iterator.h>
 
   #ifndef MINICOROS_STD
     #define MINICOROS_STD eastl
@@ -23,6 +24,7 @@
   #include <vector>
   #include <tuple>
   #include <memory>
+  #include <iterator>
 
   #ifndef MINICOROS_STD
     #define MINICOROS_STD std
@@ -33,35 +35,99 @@ namespace mc {
 
 namespace detail {
 
+template<typename T, typename = void>
+struct is_range : public MINICOROS_STD::false_type {};
+
+template<typename T>
+struct is_range<T, MINICOROS_STD::void_t<decltype(MINICOROS_STD::begin(MINICOROS_STD::declval<T&>())), decltype(MINICOROS_STD::end(MINICOROS_STD::declval<T&>()))>> : public MINICOROS_STD::true_type {};
+
+template<typename T>
+constexpr bool is_range_v = is_range<MINICOROS_STD::remove_reference_t<T>>::value;
+
+template<typename T, typename = void>
+struct is_iterator : public MINICOROS_STD::false_type {};
+
+template<typename T>
+struct is_iterator<T, MINICOROS_STD::void_t<typename MINICOROS_STD::iterator_traits<T>::iterator_category>> : public MINICOROS_STD::true_type {};
+
+template<typename T>
+constexpr bool is_iterator_v = is_iterator<T>::value;
+
+/// Ranges the combinators can move the futures out of: the caller has to give them up with `std::move`, so that they
+/// aren't left holding moved-from futures without noticing.
+template<typename T>
+constexpr bool is_rvalue_range_v = is_range_v<T> && !MINICOROS_STD::is_lvalue_reference_v<T>;
+
+template<typename T, typename = void>
+struct is_moving_iterator : public MINICOROS_STD::false_type {};
+
+template<typename T>
+struct is_moving_iterator<T, MINICOROS_STD::enable_if_t<is_iterator_v<T>>>
+  : public MINICOROS_STD::bool_constant<!MINICOROS_STD::is_lvalue_reference_v<typename MINICOROS_STD::iterator_traits<T>::reference>> {};
+
+/// Iterators that the combinators can move the futures out of: ones that move them out themselves (see
+/// `std::make_move_iterator`) or create them.
+template<typename T>
+constexpr bool is_moving_iterator_v = is_moving_iterator<T>::value;
+
+/// The `T` in the `future<T>`s of a range.
+template<typename RangeType>
+using range_future_type_t = typename MINICOROS_STD::decay_t<decltype(*MINICOROS_STD::begin(MINICOROS_STD::declval<RangeType&>()))>::type;
+
+template<typename IteratorType>
+struct iterator_range {
+  IteratorType first;
+  IteratorType last;
+
+  IteratorType begin() const {return first; }
+  IteratorType end() const {return last; }
+};
+
 /// Unwrap the chains from their future overcoats. Futures aren't copy-constructible, but the chains are. Remove
 /// this when we have move-only std::function.
-template<typename T>
-MINICOROS_STD::vector<continuation_chain<concrete_result<T>>> unwrap_chains(MINICOROS_STD::vector<future<T>>&& futures) {
-  MINICOROS_STD::vector<continuation_chain<concrete_result<T>>> chains;
-  chains.reserve(futures.size());
+/// The futures are moved out of the range one by one, so the range can be anything that can be iterated over, such
+/// as an array or a range that creates the futures lazily.
+template<typename RangeType>
+auto unwrap_chains(RangeType&& futures) {
+  using T = range_future_type_t<RangeType>;
+  using IteratorCategory = typename MINICOROS_STD::iterator_traits<decltype(MINICOROS_STD::begin(futures))>::iterator_category;
+
+  chain_vector<T> chains;
+
+  if constexpr (MINICOROS_STD::is_base_of_v<MINICOROS_STD::forward_iterator_tag, IteratorCategory>)
+    chains.reserve(static_cast<size_t>(MINICOROS_STD::distance(MINICOROS_STD::begin(futures), MINICOROS_STD::end(futures))));
 
-  for (future<T>& fut : futures)
-    chains.push_back(MINICOROS_STD::move(fut).chain());
+  for (auto it = MINICOROS_STD::begin(futures), end = MINICOROS_STD::end(futures); it != end; ++it)
+    chains.push_back(MINICOROS_STD::move(*it).chain());
 
   return chains;
 }
 
 } // detail
 
-template<typename T>
-auto when_all(MINICOROS_STD::vector<future<T>>&& futures) {
+/// Waits for all the futures in the given range and resolves to a vector of their values, in the same order as the
+/// futures. The first failure is propagated, and cancels the remaining futures (see `when_any`).
+/// Any range of futures can be given (a vector, an array, a range that creates the futures when iterated over...);
+/// the futures are moved out of it one by one, so there's no need to collect them in a vector first. The range has to
+/// be an rvalue (`when_all(std::move(futures))`), since it's left holding moved-from futures.
+template<typename RangeType, typename = MINICOROS_STD::enable_if_t<detail::is_rvalue_range_v<RangeType>>>
+auto when_all(RangeType&& futures) {
+  using T = detail::range_future_type_t<RangeType>;
   using ResultType = typename detail::vector_result<T>::value_type;
-  auto chains = detail::unwrap_chains(MINICOROS_STD::move(futures));
+  auto chains = detail::unwrap_chains(MINICOROS_STD::forward<RangeType>(futures));
 
-  return future<ResultType>([chains = MINICOROS_STD::move(chains)](promise<ResultType>&& p) mutable {
+  return future<ResultType>([resource = detail::current_memory_resource(), chains = MINICOROS_STD::move(chains)](promise<ResultType>&& p) mutable {
     if (chains.empty()) {
       p(concrete_result<ResultType>{});
       return;
     }
 
-    auto result_builder = MINICOROS_STD::make_shared<detail::vector_result<T>>(MINICOROS_STD::move(p));
+    auto result_builder = detail::allocate_state<detail::vector_result<T>>(resource, MINICOROS_STD::move(p));
     result_builder->resize(static_cast<int>(chains.size()));
 
+    auto cancellation = detail::cancellation_of(result_builder);
+    detail::cancellation_scope scope{cancellation};
+
     for (size_t i = 0; i < chains.size(); ++i) {
       MINICOROS_STD::move(chains[static_cast<int>(i)]).evaluate_into([i, result_builder] (concrete_result<T>&& result) {
         result_builder->assign(static_cast<int>(i), MINICOROS_STD::move(result));
@@ -70,19 +136,90 @@ auto when_all(MINICOROS_STD::vector<future<T>>&& futures) {
   });
 }
 
+/// Same as above, but takes the futures from the iterator range [first, last). The iterators have to move the futures
+/// out (`std::make_move_iterator`) or create them.
+template<typename IteratorType, typename = MINICOROS_STD::enable_if_t<detail::is_moving_iterator_v<IteratorType>>>
+auto when_all(IteratorType first, IteratorType last) {
+  return when_all(detail::iterator_range<IteratorType>{first, last});
+}
+
+/// Waits for all the given futures, which may be of different types, and resolves to their values as one flat
+/// tuple. `void` values are left out, tuple values are concatenated and a single remaining value isn't wrapped in a
+/// tuple. All the futures share one state and the tuple is only built once. Equivalent to joining `f1 && ... && fn`.
+/// The first failure is propagated.
+///
+/// ```cpp
+/// when_all(make_successful_future<int>(1), make_successful_future<void>(), make_successful_future<std::string>("a"))
+///   .then([](int i, std::string s) {
+///     ...
+///   });
+/// ```
+template<typename... FutureTypes, typename = MINICOROS_STD::enable_if_t<(detail::is_future_v<FutureTypes> && ...)>>
+auto when_all(FutureTypes&&... futures) {
+  return detail::join_futures(MINICOROS_STD::tuple_cat(detail::operands_of(MINICOROS_STD::move(futures))...));
+}
+
 /// Returns the first result from any of the futures. If the first result is a failure,
 /// `when_any` will return that failure.
-template<typename T>
-auto when_any(MINICOROS_STD::vector<future<T>>&& futures) {
-  auto chains = detail::unwrap_chains(MINICOROS_STD::move(futures));
+/// The remaining futures are cancelled: the handlers they haven't run yet are skipped and released.
+///
+/// Cancellation is cooperative. A cancelled future's handlers, `finally` handlers included, are skipped once the
+/// operation it's waiting on resolves, and released once that operation lets go of its promise; not when the future is
+/// cancelled, since until then the operation holds on to them. Cleanup that has to happen belongs in the destructors
+/// of what the handlers capture rather than in `finally`.
+template<typename RangeType, typename = MINICOROS_STD::enable_if_t<detail::is_rvalue_range_v<RangeType>>>
+auto when_any(RangeType&& futures) {
+  using T = detail::range_future_type_t<RangeType>;
+  auto chains = detail::unwrap_chains(MINICOROS_STD::forward<RangeType>(futures));
+
+  return future<T>([resource = detail::current_memory_resource(), chains = MINICOROS_STD::move(chains)](promise<T>&& p) mutable {
+    if (chains.empty()) {
+      p(concrete_result<T>{});
+      return;
+    }
 
-  return future<T>([chains = MINICOROS_STD::move(chains)](promise<T>&& p) mutable {
+    auto result_builder = detail::allocate_state<detail::any_result<T>>(resource, MINICOROS_STD::move(p));
+    auto cancellation = detail::cancellation_of(result_builder);
+    detail::cancellation_scope scope{cancellation};
+
+    for (size_t i = 0; i < chains.size(); ++i) {
+      MINICOROS_STD::move(chains[static_cast<int>(i)]).evaluate_into([result_builder] (concrete_result<T>&& result) {
+        result_builder->assign(MINICOROS_STD::move(result));
+      });
+    }
+  });
+}
+
+template<typename IteratorType, typename = MINICOROS_STD::enable_if_t<detail::is_moving_iterator_v<IteratorType>>>
+auto when_any(IteratorType first, IteratorType last) {
+  return when_any(detail::iterator_range<IteratorType>{first, last});
+}
+
+/// Returns the first successful result from any of the futures; failures are skipped as long as there are futures
+/// left that may still succeed. Only once all of them have failed does the returned future fail, with the error
+/// `error_reducer` builds out of the errors of all the futures (in the order they failed). The remaining futures are
+/// cancelled once one of them succeeds.
+///
+/// ```cpp
+/// when_any_success(replica_reads, [](std::vector<error>&& errors) {
+///   return error{"all replicas failed", std::move(errors)};
+/// });
+/// ```
+template<typename RangeType, typename ErrorReducerType, typename = MINICOROS_STD::enable_if_t<detail::is_rvalue_range_v<RangeType>>>
+auto when_any_success(RangeType&& futures, ErrorReducerType&& error_reducer) {
+  using T = detail::range_future_type_t<RangeType>;
+  using ResultBuilderType = detail::success_result<T, MINICOROS_STD::decay_t<ErrorReducerType>>;
+  auto chains = detail::unwrap_chains(MINICOROS_STD::forward<RangeType>(futures));
+
+  return future<T>([resource = detail::current_memory_resource(), chains = MINICOROS_STD::move(chains), error_reducer = MINICOROS_STD::forward<ErrorReducerType>(error_reducer)](promise<T>&& p) mutable {
     if (chains.empty()) {
       p(concrete_result<T>{});
       return;
     }
 
-    auto result_builder = MINICOROS_STD::make_shared<detail::any_result<T>>(MINICOROS_STD::move(p));
+    auto result_builder = detail::allocate_state<ResultBuilderType>(resource, MINICOROS_STD::move(p), static_cast<size_t>(chains.size()), MINICOROS_STD::move(error_reducer));
+    auto cancellation = detail::cancellation_of(result_builder);
+    detail::cancellation_scope scope{cancellation};
 
     for (size_t i = 0; i < chains.size(); ++i) {
       MINICOROS_STD::move(chains[static_cast<int>(i)]).evaluate_into([result_builder] (concrete_result<T>&& result) {
@@ -92,19 +229,307 @@ auto when_any(MINICOROS_STD::vector<future<T>>&& futures) {
   });
 }
 
+/// Like above, but fails with the error of the last future to fail.
+template<typename RangeType, typename = MINICOROS_STD::enable_if_t<detail::is_rvalue_range_v<RangeType>>>
+auto when_any_success(RangeType&& futures) {
+  return when_any_success(MINICOROS_STD::forward<RangeType>(futures), detail::last_error{});
+}
+
+template<typename IteratorType, typename = MINICOROS_STD::enable_if_t<detail::is_moving_iterator_v<IteratorType>>>
+auto when_any_success(IteratorType first, IteratorType last) {
+  return when_any_success(detail::iterator_range<IteratorType>{first, last});
+}
+
+/// Waits for `count` of the futures to succeed and resolves to their values in the order they arrived (or to `void`
+/// for `future<void>`s). Fails with the error that made `count` successes impossible, that is, once more than
+/// `size - count` futures have failed. The futures that are still pending when the result is decided are cancelled.
+/// `count` must not be larger than the number of futures.
+///
+/// ```cpp
+/// when_n(2, write_to_replicas(data))
+///   .then([](std::vector<ack> acks) {
+///     ...
+///   });
+/// ```
+template<typename RangeType, typename = MINICOROS_STD::enable_if_t<detail::is_rvalue_range_v<RangeType>>>
+auto when_n(size_t count, RangeType&& futures) {
+  using T = detail::range_future_type_t<RangeType>;
+  using ResultType = typename detail::quorum_result<T>::value_type;
+  auto chains = detail::unwrap_chains(MINICOROS_STD::forward<RangeType>(futures));
+  assert(count <= static_cast<size_t>(chains.size()) && "when_n can't wait for more futures than it was given");
+
+  return future<ResultType>([resource = detail::current_memory_resource(), count, chains = MINICOROS_STD::move(chains)](promise<ResultType>&& p) mutable {
+    if (count == 0) {
+      p(concrete_result<ResultType>{});
+      return;
+    }
+
+    auto result_builder = detail::allocate_state<detail::quorum_result<T>>(resource, MINICOROS_STD::move(p), count, static_cast<size_t>(chains.size()));
+    auto cancellation = detail::cancellation_of(result_builder);
+    detail::cancellation_scope scope{cancellation};
+
+    for (size_t i = 0; i < chains.size(); ++i) {
+      MINICOROS_STD::move(chains[static_cast<int>(i)]).evaluate_into([result_builder] (concrete_result<T>&& result) {
+        result_builder->assign(MINICOROS_STD::move(result));
+      });
+    }
+  });
+}
+
+template<typename IteratorType, typename = MINICOROS_STD::enable_if_t<detail::is_moving_iterator_v<IteratorType>>>
+auto when_n(size_t count, IteratorType first, IteratorType last) {
+  return when_n(count, detail::iterator_range<IteratorType>{first, last});
+}
+
+/// Returns the first result from any of the given futures, which may be of different types. The value is a
+/// variant whose index is the index of the future that finished first; `void` futures are represented by a
+/// `monostate`. Like `when_any` above, a failure is returned if it comes first, and the remaining futures are
+/// cancelled.
+///
+/// ```cpp
+/// when_any(lookup_cache(key), compute(key))
+///   .then([](std::variant<entry, computed> value) {
+///     ...
+///   });
+/// ```
+template<typename... FutureTypes, typename = MINICOROS_STD::enable_if_t<(sizeof...(FutureTypes) > 0) && (detail::is_future_v<FutureTypes> && ...)>>
+auto when_any(FutureTypes&&... futures) {
+  using ResultBuilderType = detail::variant_any_result<typename FutureTypes::type...>;
+  using ResultType = typename ResultBuilderType::value_type;
+
+  auto chains = MINICOROS_STD::make_tuple(future<typename FutureTypes::type>{MINICOROS_STD::move(futures)}.chain()...);
+
+  return future<ResultType>([resource = detail::current_memory_resource(), chains = MINICOROS_STD::move(chains)](promise<ResultType>&& p) mutable {
+    auto result_builder = detail::allocate_state<ResultBuilderType>(resource, MINICOROS_STD::move(p));
+    detail::evaluate_into_indexed(MINICOROS_STD::move(chains), result_builder, MINICOROS_STD::index_sequence_for<FutureTypes...>());
+  });
+}
+
 /// Evaluates the given futures in sequential order and returns all the results.
-template<typename T>
-auto when_seq(MINICOROS_STD::vector<future<T>>&& futures) {
+template<typename RangeType, typename = MINICOROS_STD::enable_if_t<detail::is_rvalue_range_v<RangeType>>>
+auto when_seq(RangeType&& futures) {
+  using T = detail::range_future_type_t<RangeType>;
   using ResultType = typename detail::vector_result<T>::value_type;
-  auto chains = detail::unwrap_chains(MINICOROS_STD::move(futures));
+  auto chains = detail::unwrap_chains(MINICOROS_STD::forward<RangeType>(futures));
 
-  return future<ResultType>([chains = MINICOROS_STD::move(chains)](promise<ResultType>&& p) mutable {
+  return future<ResultType>([resource = detail::current_memory_resource(), chains = MINICOROS_STD::move(chains)](promise<ResultType>&& p) mutable {
     if (chains.empty()) {
       p(concrete_result<ResultType>{});
       return;
     }
 
-    MINICOROS_STD::make_shared<detail::seq_submitter<T>>(MINICOROS_STD::move(p), MINICOROS_STD::move(chains))->evaluate();
+    detail::allocate_state<detail::seq_submitter<T>>(resource, MINICOROS_STD::move(p), MINICOROS_STD::move(chains))->evaluate();
+  });
+}
+
+template<typename IteratorType, typename = MINICOROS_STD::enable_if_t<detail::is_moving_iterator_v<IteratorType>>>
+auto when_seq(IteratorType first, IteratorType last) {
+  return when_seq(detail::iterator_range<IteratorType>{first, last});
+}
+
+/// Evaluates `count` futures in sequential order and returns all the results, like `when_seq` above. The futures
+/// are created lazily by calling `factory(index)`, which must return a `future<T>`; each future is created when
+/// the previous one has finished, and released as soon as it has finished itself. The first failure is propagated
+/// and stops any further futures from being created.
+///
+/// ```cpp
+/// when_seq(records.size(), [&](size_t index) {
+///   return migrate(records[index]);
+/// });
+/// ```
+template<typename FactoryType, typename = MINICOROS_STD::enable_if_t<MINICOROS_STD::is_invocable_v<FactoryType&, size_t>>>
+auto when_seq(size_t count, FactoryType&& factory) {
+  using T = typename MINICOROS_STD::invoke_result_t<FactoryType&, size_t>::type;
+  using ResultType = typename detail::vector_result<T>::value_type;
+  using StoredFactoryType = MINICOROS_STD::decay_t<FactoryType>;
+
+  return future<ResultType>([resource = detail::current_memory_resource(), count, factory = StoredFactoryType{MINICOROS_STD::forward<FactoryType>(factory)}](promise<ResultType>&& p) mutable {
+    if (count == 0) {
+      p(concrete_result<ResultType>{});
+      return;
+    }
+
+    detail::allocate_state<detail::lazy_seq_submitter<T, StoredFactoryType>>(resource, MINICOROS_STD::move(p), count, MINICOROS_STD::move(factory))->evaluate();
+  });
+}
+
+/// Hedged request: evaluates `factory(attempt)` for `attempt = 0`, and each time the future returned by `delay()`
+/// resolves without an answer having arrived, evaluates another attempt alongside the ones in flight, up to
+/// `max_attempts` in total. An attempt that fails starts the next one right away. Resolves with the first successful
+/// value and cancels the attempts (and delays) that are still pending; fails with the last error if every attempt
+/// fails. `delay` is where the timer comes from, typically an executor or clock of the caller's.
+///
+/// ```cpp
+/// hedge([&](size_t attempt) {return read_from(replicas[attempt]); },
+///       [&] {return timers.after(10ms); },
+///       replicas.size());
+/// ```
+template<typename FactoryType, typename DelayType>
+auto hedge(FactoryType&& factory, DelayType&& delay, size_t max_attempts) {
+  assert(max_attempts > 0 && "hedge needs to make at least one attempt");
+
+  using FutureType = MINICOROS_STD::decay_t<decltype(factory(size_t{}))>;
+  using T = typename FutureType::type;
+  using StoredFactoryType = MINICOROS_STD::decay_t<FactoryType>;
+  using StoredDelayType = MINICOROS_STD::decay_t<DelayType>;
+  static_assert(MINICOROS_STD::is_same_v<MINICOROS_STD::decay_t<decltype(delay())>, future<void>>, "hedge needs delay() to return a future<void>");
+
+  return future<T>([resource = detail::current_memory_resource(), factory = MINICOROS_STD::forward<FactoryType>(factory), delay = MINICOROS_STD::forward<DelayType>(delay), max_attempts](promise<T>&& p) mutable {
+    detail::allocate_state<detail::hedge_submitter<T, StoredFactoryType, StoredDelayType>>(resource, MINICOROS_STD::move(p), max_attempts, MINICOROS_STD::move(factory), MINICOROS_STD::move(delay))->evaluate();
+  });
+}
+
+/// Evaluates `factory(attempt)` and, as long as it fails and `policy.max_attempts` hasn't been reached, waits for
+/// `sleep(delay)` and evaluates it again, backing off exponentially with jitter (see `retry_policy`). Resolves with the
+/// first success, or the last failure. The attempts are evaluated one after another at a constant chain and stack
+/// depth. `sleep` is where the waiting happens, typically through an executor or clock of the caller's; a failing
+/// `sleep` fails the retry.
+///
+/// ```cpp
+/// retry([&](size_t) {return fetch(url); },
+///       retry_policy{5, 50ms},
+///       [&](std::chrono::milliseconds delay) {return timers.after(delay); });
+/// ```
+template<typename FactoryType, typename SleepType>
+auto retry(FactoryType&& factory, const retry_policy& policy, SleepType&& sleep) {
+  assert(policy.max_attempts > 0 && "retry needs to make at least one attempt");
+
+  using FutureType = MINICOROS_STD::decay_t<decltype(factory(size_t{}))>;
+  using T = typename FutureType::type;
+  using StoredFactoryType = MINICOROS_STD::decay_t<FactoryType>;
+  using StoredSleepType = MINICOROS_STD::decay_t<SleepType>;
+  static_assert(MINICOROS_STD::is_same_v<MINICOROS_STD::decay_t<decltype(sleep(policy.initial_delay))>, future<void>>, "retry needs sleep(delay) to return a future<void>");
+
+  return future<T>([resource = detail::current_memory_resource(), factory = MINICOROS_STD::forward<FactoryType>(factory), policy, sleep = MINICOROS_STD::forward<SleepType>(sleep)](promise<T>&& p) mutable {
+    detail::allocate_state<detail::retry_submitter<T, StoredFactoryType, StoredSleepType>>(resource, MINICOROS_STD::move(p), policy, MINICOROS_STD::move(factory), MINICOROS_STD::move(sleep))->evaluate();
+  });
+}
+
+/// Async loop: evaluates the future returned by `body()` over and over for as long as it resolves to `true`. The
+/// first failure is propagated. Unlike a `.then` that returns a new future from itself, memory and stack usage stay
+/// constant no matter how many iterations run, or whether they finish synchronously.
+///
+/// ```cpp
+/// repeat([&] {
+///   return read_page(cursor).then([&](page&& p) {
+///     cursor = p.next;
+///     return !p.last;
+///   });
+/// });
+/// ```
+template<typename BodyType>
+future<void> repeat(BodyType&& body) {
+  using StoredBodyType = MINICOROS_STD::decay_t<BodyType>;
+
+  return future<void>([resource = detail::current_memory_resource(), body = MINICOROS_STD::forward<BodyType>(body)](promise<void>&& p) mutable {
+    detail::allocate_state<detail::loop_submitter<detail::always_true, StoredBodyType>>(resource, MINICOROS_STD::move(p), detail::always_true{}, MINICOROS_STD::move(body))->evaluate();
+  });
+}
+
+/// Async loop: evaluates the future returned by `body()` for as long as `condition()` returns `true` (checked
+/// before each iteration). `body` can return `future<void>`, or `future<bool>` to also be able to stop the loop
+/// itself by resolving to `false`. Like `repeat`, it runs in constant memory and stack.
+template<typename ConditionType, typename BodyType>
+future<void> while_(ConditionType&& condition, BodyType&& body) {
+  using StoredConditionType = MINICOROS_STD::decay_t<ConditionType>;
+  using StoredBodyType = MINICOROS_STD::decay_t<BodyType>;
+
+  return future<void>([resource = detail::current_memory_resource(), condition = MINICOROS_STD::forward<ConditionType>(condition), body = MINICOROS_STD::forward<BodyType>(body)](promise<void>&& p) mutable {
+    detail::allocate_state<detail::loop_submitter<StoredConditionType, StoredBodyType>>(resource, MINICOROS_STD::move(p), MINICOROS_STD::move(condition), MINICOROS_STD::move(body))->evaluate();
+  });
+}
+
+/// Like `when_all`, but evaluates at most `max_in_flight` of the futures at the same time. The futures are
+/// evaluated in order, and the next one is evaluated as soon as a previous one finishes. The values are returned in
+/// the same order as the futures. The first failure is propagated and stops the remaining futures from being evaluated.
+template<typename RangeType, typename = MINICOROS_STD::enable_if_t<detail::is_rvalue_range_v<RangeType>>>
+auto when_all_limited(RangeType&& futures, size_t max_in_flight) {
+  assert(max_in_flight > 0 && "when_all_limited needs to evaluate at least one future at a time");
+
+  using T = detail::range_future_type_t<RangeType>;
+  using ResultType = typename detail::vector_result<T>::value_type;
+  auto chains = detail::unwrap_chains(MINICOROS_STD::forward<RangeType>(futures));
+
+  return future<ResultType>([resource = detail::current_memory_resource(), chains = MINICOROS_STD::move(chains), max_in_flight](promise<ResultType>&& p) mutable {
+    if (chains.empty()) {
+      p(concrete_result<ResultType>{});
+      return;
+    }
+
+    detail::allocate_state<detail::limited_submitter<T>>(resource, MINICOROS_STD::move(p), MINICOROS_STD::move(chains), max_in_flight)->evaluate();
+  });
+}
+
+/// Calls `handler(index, value)` (or `handler(index)` for `future<void>`) for each of the futures as soon as its
+/// value arrives, ie, in completion order. `index` is the position of the future in the range. Values can be
+/// processed and released right away, instead of being collected like `when_all` does.
+/// Resolves when all values have been handled. The first failure is propagated, and no values are handled after it.
+///
+/// ```cpp
+/// when_each(std::move(downloads), [](size_t index, std::string contents) {
+///   store(index, std::move(contents));
+/// });
+/// ```
+template<typename RangeType, typename HandlerType, typename = MINICOROS_STD::enable_if_t<detail::is_rvalue_range_v<RangeType>>>
+future<void> when_each(RangeType&& futures, HandlerType&& handler) {
+  using T = detail::range_future_type_t<RangeType>;
+  using StoredHandlerType = MINICOROS_STD::decay_t<HandlerType>;
+  auto chains = detail::unwrap_chains(MINICOROS_STD::forward<RangeType>(futures));
+
+  return future<void>([resource = detail::current_memory_resource(), chains = MINICOROS_STD::move(chains), handler = StoredHandlerType{MINICOROS_STD::forward<HandlerType>(handler)}](promise<void>&& p) mutable {
+    if (chains.empty()) {
+      p({});
+      return;
+    }
+
+    auto result_builder = detail::allocate_state<detail::each_result<T, StoredHandlerType>>(resource, MINICOROS_STD::move(p), chains.size(), MINICOROS_STD::move(handler));
+    auto cancellation = detail::cancellation_of(result_builder);
+    detail::cancellation_scope scope{cancellation};
+
+    for (size_t i = 0; i < chains.size(); ++i) {
+      MINICOROS_STD::move(chains[i]).evaluate_into([i, result_builder] (concrete_result<T>&& result) {
+        result_builder->assign(i, MINICOROS_STD::move(result));
+      });
+    }
+  });
+}
+
+/// Waits for all the futures and folds their values into `init` using `operation(accumulator, value)`, which returns
+/// the new accumulator. Values are folded as soon as they arrive, ie, in completion order, so the operation should be
+/// associative and commutative. Unlike `when_all`, the values are never collected. The first failure is propagated.
+///
+/// ```cpp
+/// when_all_reduce(std::move(shard_counts), 0, std::plus<int>{});
+/// ```
+template<typename RangeType, typename AccumulatorType, typename OperationType, typename = MINICOROS_STD::enable_if_t<detail::is_rvalue_range_v<RangeType>>>
+auto when_all_reduce(RangeType&& futures, AccumulatorType&& init, OperationType&& operation) {
+  using T = detail::range_future_type_t<RangeType>;
+  using ResultType = MINICOROS_STD::decay_t<AccumulatorType>;
+  using StoredOperationType = MINICOROS_STD::decay_t<OperationType>;
+  static_assert(!MINICOROS_STD::is_void_v<T>, "when_all_reduce needs values to reduce");
+
+  auto chains = detail::unwrap_chains(MINICOROS_STD::forward<RangeType>(futures));
+
+  return future<ResultType>([
+    resource = detail::current_memory_resource(),
+    chains = MINICOROS_STD::move(chains),
+    init = ResultType{MINICOROS_STD::forward<AccumulatorType>(init)},
+    operation = StoredOperationType{MINICOROS_STD::forward<OperationType>(operation)}
+  ](promise<ResultType>&& p) mutable {
+    if (chains.empty()) {
+      p(MINICOROS_STD::move(init));
+      return;
+    }
+
+    auto result_builder = detail::allocate_state<detail::reduce_result<T, ResultType, StoredOperationType>>(resource, MINICOROS_STD::move(p), chains.size(), MINICOROS_STD::move(init), MINICOROS_STD::move(operation));
+    auto cancellation = detail::cancellation_of(result_builder);
+    detail::cancellation_scope scope{cancellation};
+
+    for (size_t i = 0; i < chains.size(); ++i) {
+      MINICOROS_STD::move(chains[i]).evaluate_into([result_builder] (concrete_result<T>&& result) {
+        result_builder->assign(MINICOROS_STD::move(result));
+      });
+    }
   });
 }
 
@@ -0,0 +1,166 @@
+/// Copyright (C) 2022 Electronic Arts Inc.  All rights reserved.
+
+#ifndef MINICOROS_PRIORITY_EXECUTOR_H_
+#define MINICOROS_PRIORITY_EXECUTOR_H_
+
+#ifdef MINICOROS_CUSTOM_INCLUDE
+  #include MINICOROS_CUSTOM_INCLUDE
+#endif
+
+#include <minicoros/future.h>
+#include <minicoros/detail/unique_work.h>
+
+#include <mutex>
+
+#ifdef MINICOROS_USE_EASTL
+  #include <eastl/deque.h>
+  #include <eastl/utility.h>
+  #include <eastl/vector.h>
+  #include <cassert>
+
+  #ifndef MINICOROS_STD
+    #define MINICOROS_STD eastl
+  #endif
+#else
+  #include <deque>
+  #include <utility>
+  #include <vector>
+  #include <cassert>
+
+  #ifndef MINICOROS_STD
+    #define MINICOROS_STD std
+  #endif
+#endif
+
+namespace mc {
+
+/// Executor adapter with priority lanes on top of another executor (typically a `thread_pool`). Lane 0 has the
+/// highest priority. Each piece of work given to a lane hands one runner to the underlying executor, and that runner
+/// runs whatever has the highest priority by the time it gets to run, so urgent work overtakes work that was queued
+/// before it:
+///
+/// ```cpp
+/// mc::thread_pool pool;
+/// mc::priority_executor lanes{pool, 2};
+///
+/// rpc_reply()
+///   .enqueue(mc::with_priority(lanes, 0))
+///   .then([](reply&& r) {...});
+/// ```
+///
+/// A lane that has work waiting is aged each time it's passed over, and goes first once it has been passed over
+/// `max_skips` times, so lower lanes make progress however busy the higher ones are. Like `future::enqueue`, the
+/// underlying executor is copied unless it can't be, in which case it's referenced. The executor has to outlive the
+/// work given to it.
+template<typename ExecutorType>
+class priority_executor {
+public:
+  /// Executor that gives work to one lane of a `priority_executor`.
+  class lane {
+  public:
+    lane(priority_executor& executor, size_t priority) : executor_(&executor), priority_(priority) {}
+
+    template<typename WorkType>
+    void operator ()(WorkType&& work) const {
+      executor_->post(priority_, detail::unique_work{MINICOROS_STD::forward<WorkType>(work)});
+    }
+
+  private:
+    priority_executor* executor_;
+    size_t priority_;
+  };
+
+  template<typename UnderlyingExecutorType>
+  explicit priority_executor(UnderlyingExecutorType&& executor, size_t num_lanes = 3, size_t max_skips = 8)
+    : executor_(detail::capture_executor(MINICOROS_STD::forward<UnderlyingExecutorType>(executor)))
+    , lanes_(num_lanes > 0 ? num_lanes : 1)
+    , max_skips_(max_skips) {}
+
+  priority_executor(const priority_executor&) = delete;
+  priority_executor& operator =(const priority_executor&) = delete;
+
+  lane at(size_t priority) {
+    assert(priority < lanes_.size() && "No such priority lane");
+    return lane{*this, priority};
+  }
+
+  size_t num_lanes() const {
+    return lanes_.size();
+  }
+
+private:
+  struct lane_state {
+    MINICOROS_STD::deque<detail::unique_work> work;
+    size_t num_skips = 0;
+  };
+
+  void post(size_t priority, detail::unique_work&& work) {
+    {
+      std::lock_guard<std::mutex> lock{mutex_};
+      lanes_[priority].work.push_back(MINICOROS_STD::move(work));
+    }
+
+    executor_([this] {run_next(); });
+  }
+
+  void run_next() {
+    detail::unique_work work;
+
+    {
+      std::lock_guard<std::mutex> lock{mutex_};
+      work = take_next();
+    }
+
+    if (work)
+      work();
+  }
+
+  /// Takes the work from the lane that has been passed over too often, or else from the highest priority lane that has
+  /// work, and ages the others that have work.
+  detail::unique_work take_next() {
+    size_t chosen = lanes_.size();
+
+    for (size_t i = 0; i < lanes_.size() && chosen == lanes_.size(); ++i) {
+      if (!lanes_[i].work.empty() && lanes_[i].num_skips >= max_skips_)
+        chosen = i;
+    }
+
+    for (size_t i = 0; i < lanes_.size() && chosen == lanes_.size(); ++i) {
+      if (!lanes_[i].work.empty())
+        chosen = i;
+    }
+
+    // There's one runner per piece of work, so there's always work for a runner
+    assert(chosen < lanes_.size());
+
+    for (size_t i = 0; i < lanes_.size(); ++i) {
+      if (i != chosen && !lanes_[i].work.empty())
+        ++lanes_[i].num_skips;
+    }
+
+    lane_state& l = lanes_[chosen];
+    l.num_skips = 0;
+
+    detail::unique_work work = MINICOROS_STD::move(l.work.front());
+    l.work.pop_front();
+    return work;
+  }
+
+  decltype(detail::capture_executor(MINICOROS_STD::declval<ExecutorType>())) executor_;
+  std::mutex mutex_;
+  MINICOROS_STD::vector<lane_state> lanes_;
+  size_t max_skips_;
+};
+
+template<typename ExecutorType, typename... ArgTypes>
+priority_executor(ExecutorType&&, ArgTypes...) -> priority_executor<ExecutorType>;
+
+/// Executor that gives work to lane `priority` of `executor`, for `future::enqueue`.
+template<typename ExecutorType>
+typename priority_executor<ExecutorType>::lane with_priority(priority_executor<ExecutorType>& executor, size_t priority) {
+  return executor.at(priority);
+}
+
+} // mc
+
+#endif // MINICOROS_PRIORITY_EXECUTOR_H_
@@ -0,0 +1,118 @@
+/// Copyright (C) 2022 Electronic Arts Inc.  All rights reserved.
+
+#ifndef MINICOROS_PUMP_EXECUTOR_H_
+#define MINICOROS_PUMP_EXECUTOR_H_
+
+#ifdef MINICOROS_CUSTOM_INCLUDE
+  #include MINICOROS_CUSTOM_INCLUDE
+#endif
+
+#include <minicoros/detail/mpsc_queue.h>
+#include <minicoros/detail/unique_work.h>
+
+#include <thread>
+
+#ifdef MINICOROS_USE_EASTL
+  #include <eastl/utility.h>
+  #include <cassert>
+
+  #ifndef MINICOROS_STD
+    #define MINICOROS_STD eastl
+  #endif
+#else
+  #include <utility>
+  #include <cassert>
+
+  #ifndef MINICOROS_STD
+    #define MINICOROS_STD std
+  #endif
+#endif
+
+namespace mc {
+
+/// Executor for work that has to run on one owner thread (typically the main thread of a game or UI), which drains
+/// it by calling `pump()`, for example once per tick. Any thread can give it work without taking a lock: the work is
+/// linked straight into an intrusive lock-free queue.
+///
+/// ```cpp
+/// mc::pump_executor main_thread;
+///
+/// load_texture(path)       // Resolves on an I/O thread
+///   .enqueue(main_thread)
+///   .then([](texture&& t) {scene.add(t); });
+///
+/// while (running) {
+///   main_thread.pump();
+///   ...
+/// }
+/// ```
+///
+/// The owner is the thread that created the executor. The executor has to outlive the work given to it; work that is
+/// still queued when it's destroyed is dropped without running.
+class pump_executor {
+public:
+  pump_executor() : owner_(std::this_thread::get_id()) {}
+
+  pump_executor(const pump_executor&) = delete;
+  pump_executor& operator =(const pump_executor&) = delete;
+
+  ~pump_executor() {
+    delete_all(queue_.take_all());
+  }
+
+  /// Any thread.
+  template<typename WorkType>
+  void operator ()(WorkType&& work) {
+    queue_.push(detail::make_work_node(MINICOROS_STD::forward<WorkType>(work)));
+  }
+
+  /// Owner thread only. Runs the work queued up until now, in the order it was given, and returns how much that was.
+  /// Work given to the executor while pumping (by the work itself, or by other threads) waits for the next call, so
+  /// that a pump always ends.
+  size_t pump() {
+    assert(std::this_thread::get_id() == owner_ && "pump_executor can only be pumped by the thread that created it");
+
+    const pump_executor* outer = current_pump();
+    current_pump() = this;
+
+    size_t count = 0;
+
+    for (detail::work_node* work = queue_.take_all(); work; ++count) {
+      detail::work_node* next = work->next;
+      work->run();
+      delete work;
+      work = next;
+    }
+
+    current_pump() = outer;
+    return count;
+  }
+
+  /// Whether the calling thread is the owner, in the middle of a `pump()`. `future::enqueue` uses this to run
+  /// continuations that resolve while pumping right away; the ones that resolve on the owner outside of `pump()` still
+  /// wait for the next one.
+  bool running_in_this_thread() const {
+    return current_pump() == this;
+  }
+
+private:
+  static const pump_executor*& current_pump() {
+    static thread_local const pump_executor* current = nullptr;
+    return current;
+  }
+
+  static void delete_all(detail::work_node* work) {
+    while (work) {
+      detail::work_node* next = work->next;
+      delete work;
+      work = next;
+    }
+  }
+
+  detail::intrusive_mpsc_queue<detail::work_node> queue_;
+  std::thread::id owner_;
+};
+
+} // mc
+
+#endif // MINICOROS_PUMP_EXECUTOR_H_
@@ -0,0 +1,403 @@
+/// Copyright (C) 2022 Electronic Arts Inc.  All rights reserved.
+
+#ifndef MINICOROS_SHARD_GROUP_H_
+#define MINICOROS_SHARD_GROUP_H_
+
+#ifdef MINICOROS_CUSTOM_INCLUDE
+  #include MINICOROS_CUSTOM_INCLUDE
+#endif
+
+#include <minicoros/future.h>
+#include <minicoros/detail/mpsc_queue.h>
+#include <minicoros/detail/spsc_ring.h>
+#include <minicoros/detail/unique_work.h>
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#ifdef __linux__
+  #include <pthread.h>
+  #include <sched.h>
+#endif
+
+#ifdef MINICOROS_USE_EASTL
+  #include <eastl/atomic.h>
+  #include <eastl/deque.h>
+  #include <eastl/unique_ptr.h>
+  #include <eastl/vector.h>
+
+  #ifndef MINICOROS_STD
+    #define MINICOROS_STD eastl
+  #endif
+#else
+  #include <atomic>
+  #include <deque>
+  #include <memory>
+  #include <vector>
+
+  #ifndef MINICOROS_STD
+    #define MINICOROS_STD std
+  #endif
+#endif
+
+namespace mc {
+
+namespace detail {
+
+template<typename T>
+struct submitted_type {
+  using type = T;
+};
+
+template<typename T>
+struct submitted_type<future<T>> {
+  using type = T;
+};
+
+} // detail
+
+/// Shared-nothing, thread-per-core executors: one thread per shard, each pinned to its own CPU out of the ones the
+/// process may run on (on Linux), and each running only the work given to its shard. Shards talk to each other over a
+/// single-producer, single-consumer ring per pair of shards, so handing work over never contends with any third shard.
+/// Work handed over from threads outside the group, or to a ring that's full, goes through a lock-free queue instead.
+///
+/// Each shard allocates its own queues from its own thread once it's pinned, so that with a first-touch NUMA policy
+/// (the default on Linux) they end up on the shard's node. The same goes for the data the shards own: allocate it
+/// from work running on the shard.
+///
+/// ```cpp
+/// mc::shard_group shards;
+///
+/// shards.submit_to(shard_of(key), [&, key] {return tables[shard_of(key)].lookup(key); })
+///   .then([](value&& v) {
+///     ... // Back on the calling shard
+///   });
+/// ```
+///
+/// The group has to outlive the work given to it. The destructor waits for all the shards to run out of work, including
+/// work they keep handing each other.
+class shard_group {
+public:
+  /// Shard index of threads that aren't part of a group
+  static constexpr size_t no_shard = ~size_t{0};
+
+  /// Executor for a single shard, usable with `future::enqueue`.
+  class executor {
+  public:
+    executor(shard_group& group, size_t index) : group_(&group), index_(index) {}
+
+    template<typename WorkType>
+    void operator ()(WorkType&& work) const {
+      group_->post(index_, detail::unique_work{MINICOROS_STD::forward<WorkType>(work)});
+    }
+
+    bool running_in_this_thread() const {
+      return group_->current_shard() == index_;
+    }
+
+  private:
+    shard_group* group_;
+    size_t index_;
+  };
+
+  /// Defaults to one shard per hardware thread. `ring_capacity` (a power of two) is the number of work items each
+  /// shard can have in flight to each other shard before falling back to the slower shared queue.
+  explicit shard_group(size_t num_shards = default_num_shards(), size_t ring_capacity = 1024, bool pin_threads = true)
+    : shards_(num_shards > 0 ? num_shards : 1) {
+    if (pin_threads)
+      cpus_ = allowed_cpus();
+
+    for (size_t i = 0; i < shards_.size(); ++i) {
+      threads_.emplace_back([this, i, ring_capacity] {
+        if (!cpus_.empty())
+          pin_current_thread(cpus_[i % cpus_.size()]);
+
+        start_shard(i, ring_capacity);
+        run_shard(i);
+      });
+    }
+
+    std::unique_lock<std::mutex> lock{startup_mutex_};
+    started_.wait(lock, [this] {return num_started_ == shards_.size(); });
+  }
+
+  shard_group(const shard_group&) = delete;
+  shard_group& operator =(const shard_group&) = delete;
+
+  ~shard_group() {
+    stopping_.store(true);
+
+    for (auto& s : shards_)
+      wake(*s);
+
+    for (auto& thread : threads_)
+      thread.join();
+  }
+
+  size_t size() const {
+    return shards_.size();
+  }
+
+  executor shard(size_t index) {
+    assert(index < shards_.size() && "No such shard");
+    return executor{*this, index};
+  }
+
+  /// The shard the calling thread runs, or `no_shard`.
+  size_t current_shard() const {
+    return current_group() == this ? current_index() : no_shard;
+  }
+
+  /// Runs `function` on shard `index` and resolves to what it returns (or, if it returns a future, to what that
+  /// resolves to). The future resolves back on the calling shard; when called from outside the group, it resolves
+  /// on shard `index`. Like all futures it's lazy: nothing is handed over until it's evaluated.
+  template<typename FunctionType>
+  auto submit_to(size_t index, FunctionType&& function) {
+    using ReturnType = decltype(function());
+    using T = typename detail::submitted_type<ReturnType>::type;
+
+    return future<T>([this, index, function = MINICOROS_STD::forward<FunctionType>(function)](promise<T>&& p) mutable {
+      const size_t origin = current_shard();
+
+      post(index, [this, index, origin, function = MINICOROS_STD::move(function), p = MINICOROS_STD::move(p)] () mutable {
+        auto reply = [this, index, origin, p = MINICOROS_STD::move(p)] (concrete_result<T>&& result) mutable {
+          if (origin == no_shard || origin == index) {
+            p(MINICOROS_STD::move(result));
+            return;
+          }
+
+          post(origin, [p = MINICOROS_STD::move(p), result = MINICOROS_STD::move(result)] () mutable {
+            p(MINICOROS_STD::move(result));
+          });
+        };
+
+        if constexpr (detail::is_future_v<ReturnType>) {
+          function().chain().evaluate_into(MINICOROS_STD::move(reply));
+        }
+        else if constexpr (MINICOROS_STD::is_void_v<T>) {
+          function();
+          reply({});
+        }
+        else {
+          reply(concrete_result<T>{function()});
+        }
+      });
+    });
+  }
+
+  /// One shard per CPU the process is allowed to run on.
+  static size_t default_num_shards() {
+    const size_t num_cpus = allowed_cpus().size();
+
+    if (num_cpus > 0)
+      return num_cpus;
+
+    const unsigned num_threads = std::thread::hardware_concurrency();
+    return num_threads > 0 ? num_threads : 1;
+  }
+
+private:
+  struct shard_state {
+    shard_state(size_t num_shards, size_t ring_capacity) {
+      incoming.reserve(num_shards);
+
+      for (size_t i = 0; i < num_shards; ++i)
+        incoming.push_back(MINICOROS_STD::unique_ptr<detail::spsc_ring<detail::unique_work>>(new detail::spsc_ring<detail::unique_work>(ring_capacity)));
+    }
+
+    /// Work the shard gave itself; only touched by the shard's own thread
+    MINICOROS_STD::deque<detail::unique_work> local;
+    /// Work from each of the other shards, indexed by the sending shard
+    MINICOROS_STD::vector<MINICOROS_STD::unique_ptr<detail::spsc_ring<detail::unique_work>>> incoming;
+    /// Work from outside the group, or from shards whose ring was full
+    detail::mpsc_queue<detail::unique_work> injected;
+
+    /// Work given to the shard that hasn't finished running yet
+    MINICOROS_STD::atomic<size_t> outstanding{0};
+
+    MINICOROS_STD::atomic<bool> sleeping{false};
+    std::mutex sleep_mutex;
+    std::condition_variable wakeup;
+  };
+
+  static shard_group*& current_group() {
+    static thread_local shard_group* group = nullptr;
+    return group;
+  }
+
+  static size_t& current_index() {
+    static thread_local size_t index = no_shard;
+    return index;
+  }
+
+  /// The CPUs in the affinity mask of the process (which `taskset` and cgroups restrict), or none if it's unknown.
+  static MINICOROS_STD::vector<int> allowed_cpus() {
+    MINICOROS_STD::vector<int> result;
+
+#ifdef __linux__
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+
+    if (sched_getaffinity(0, sizeof(cpus), &cpus) == 0) {
+      for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+        if (CPU_ISSET(cpu, &cpus))
+          result.push_back(cpu);
+      }
+    }
+#endif
+
+    return result;
+  }
+
+  static void pin_current_thread(int cpu) {
+#ifdef __linux__
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(cpu, &cpus);
+
+    // Best effort: the CPU may have been taken away from the process in the meantime
+    pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+#else
+    (void)cpu;
+#endif
+  }
+
+  void start_shard(size_t index, size_t ring_capacity) {
+    current_group() = this;
+    current_index() = index;
+
+    auto state = MINICOROS_STD::unique_ptr<shard_state>(new shard_state(shards_.size(), ring_capacity));
+
+    std::lock_guard<std::mutex> lock{startup_mutex_};
+    shards_[index] = MINICOROS_STD::move(state);
+
+    if (++num_started_ == shards_.size())
+      started_.notify_one();
+  }
+
+  void post(size_t index, detail::unique_work&& work) {
+    assert(index < shards_.size() && "No such shard");
+    shard_state& target = *shards_[index];
+    const size_t origin = current_shard();
+
+    // Counted before it's visible, so that the group can't look idle while there's work queued
+    target.outstanding.fetch_add(1, MINICOROS_STD::memory_order_relaxed);
+
+    if (origin == index)
+      target.local.push_back(MINICOROS_STD::move(work));
+    else if (origin == no_shard || !target.incoming[origin]->try_push(MINICOROS_STD::move(work)))
+      target.injected.push(MINICOROS_STD::move(work));
+
+    // Pairs with the fence in `run_shard`: either the shard sees the work before going to sleep, or we see that it's
+    // (about to go to) sleep
+    MINICOROS_STD::atomic_thread_fence(MINICOROS_STD::memory_order_seq_cst);
+
+    if (target.sleeping.load(MINICOROS_STD::memory_order_relaxed))
+      wake(target);
+  }
+
+  static void wake(shard_state& s) {
+    std::lock_guard<std::mutex> lock{s.sleep_mutex};
+    s.wakeup.notify_one();
+  }
+
+  /// Whether every shard is out of work, in which case no more work can appear (from inside the group)
+  bool idle() const {
+    for (auto& s : shards_) {
+      if (s->outstanding.load(MINICOROS_STD::memory_order_acquire) > 0)
+        return false;
+    }
+
+    return true;
+  }
+
+  void finish_work(shard_state& s) {
+    if (s.outstanding.fetch_sub(1, MINICOROS_STD::memory_order_acq_rel) == 1 && stopping_.load()) {
+      // Let the other shards check whether the whole group is idle
+      for (auto& other : shards_)
+        wake(*other);
+    }
+  }
+
+  static bool has_work(shard_state& s) {
+    if (!s.local.empty() || !s.injected.empty())
+      return true;
+
+    for (auto& ring : s.incoming) {
+      if (!ring->empty())
+        return true;
+    }
+
+    return false;
+  }
+
+  /// Runs all the work currently queued for the shard and returns whether there was any.
+  bool run_queued_work(shard_state& s) {
+    bool ran = false;
+    detail::unique_work work;
+
+    while (!s.local.empty()) {
+      work = MINICOROS_STD::move(s.local.front());
+      s.local.pop_front();
+      work();
+      finish_work(s);
+      ran = true;
+    }
+
+    for (auto& ring : s.incoming) {
+      while (ring->try_pop(work)) {
+        work();
+        finish_work(s);
+        ran = true;
+      }
+    }
+
+    ran = s.injected.drain([this, &s] (detail::unique_work&& w) {
+      w();
+      finish_work(s);
+    }) > 0 || ran;
+
+    return ran;
+  }
+
+  void run_shard(size_t index) {
+    shard_state& self = *shards_[index];
+
+    for (;;) {
+      if (run_queued_work(self))
+        continue;
+
+      if (stopping_.load() && idle())
+        break;
+
+      self.sleeping.store(true, MINICOROS_STD::memory_order_relaxed);
+      MINICOROS_STD::atomic_thread_fence(MINICOROS_STD::memory_order_seq_cst);
+
+      {
+        std::unique_lock<std::mutex> lock{self.sleep_mutex};
+        self.wakeup.wait(lock, [&] {return has_work(self) || (stopping_.load() && idle()); });
+      }
+
+      self.sleeping.store(false, MINICOROS_STD::memory_order_relaxed);
+    }
+
+    current_group() = nullptr;
+    current_index() = no_shard;
+  }
+
+  MINICOROS_STD::vector<MINICOROS_STD::unique_ptr<shard_state>> shards_;
+  MINICOROS_STD::vector<std::thread> threads_;
+  /// The CPUs the shards are pinned to, round-robin; empty when they aren't pinned
+  MINICOROS_STD::vector<int> cpus_;
+
+  std::mutex startup_mutex_;
+  std::condition_variable started_;
+  size_t num_started_ = 0;
+
+  MINICOROS_STD::atomic<bool> stopping_{false};
+};
+
+} // mc
+
+#endif // MINICOROS_SHARD_GROUP_H_
@@ -0,0 +1,121 @@
+/// Copyright (C) 2022 Electronic Arts Inc.  All rights reserved.
+
+#ifndef MINICOROS_STRAND_H_
+#define MINICOROS_STRAND_H_
+
+#ifdef MINICOROS_CUSTOM_INCLUDE
+  #include MINICOROS_CUSTOM_INCLUDE
+#endif
+
+#include <minicoros/future.h>
+#include <minicoros/detail/mpsc_queue.h>
+#include <minicoros/detail/unique_work.h>
+
+#ifdef MINICOROS_USE_EASTL
+  #include <eastl/atomic.h>
+  #include <eastl/utility.h>
+
+  #ifndef MINICOROS_STD
+    #define MINICOROS_STD eastl
+  #endif
+#else
+  #include <atomic>
+  #include <utility>
+
+  #ifndef MINICOROS_STD
+    #define MINICOROS_STD std
+  #endif
+#endif
+
+namespace mc {
+
+/// Executor adapter that runs the work given to it one item at a time, in the order it was given, on top of another
+/// executor. Nothing blocks: work is linked into an intrusive lock-free queue, and whoever takes the queue from empty to
+/// non-empty hands a single runner to the underlying executor, which then runs everything queued up by the time it
+/// gets to run.
+///
+/// ```cpp
+/// mc::thread_pool pool;
+/// mc::strand session_strand{pool};
+///
+/// read_message(socket)
+///   .enqueue(session_strand)
+///   .then([&](message&& m) {session.handle(m); }); // Never runs concurrently with other work on the strand
+/// ```
+///
+/// Like `future::enqueue`, the underlying executor is copied unless it can't be, in which case it's referenced.
+/// The strand has to outlive the work enqueued on it.
+template<typename ExecutorType>
+class strand {
+public:
+  template<typename UnderlyingExecutorType>
+  explicit strand(UnderlyingExecutorType&& executor) : executor_(detail::capture_executor(MINICOROS_STD::forward<UnderlyingExecutorType>(executor))) {}
+
+  strand(const strand&) = delete;
+  strand& operator =(const strand&) = delete;
+
+  ~strand() {
+    for (detail::work_node* work = queue_.take_all(); work;) {
+      detail::work_node* next = work->next;
+      delete work;
+      work = next;
+    }
+  }
+
+  template<typename WorkType>
+  void operator ()(WorkType&& work) {
+    // Count first, so that the runner keeps going until it has seen this work even if it looks at the queue before
+    // we've pushed it
+    const bool start_runner = num_pending_.fetch_add(1, MINICOROS_STD::memory_order_acq_rel) == 0;
+    queue_.push(detail::make_work_node(MINICOROS_STD::forward<WorkType>(work)));
+
+    if (start_runner)
+      schedule_runner();
+  }
+
+  /// Whether the calling thread is running work from this strand.
+  bool running_in_this_thread() const {
+    return current_strand() == this;
+  }
+
+private:
+  static const strand*& current_strand() {
+    static thread_local const strand* current = nullptr;
+    return current;
+  }
+
+  void schedule_runner() {
+    executor_([this] {run(); });
+  }
+
+  void run() {
+    const strand* outer = current_strand();
+    current_strand() = this;
+
+    size_t num_run = 0;
+
+    for (detail::work_node* work = queue_.take_all(); work; ++num_run) {
+      detail::work_node* next = work->next;
+      work->run();
+      delete work;
+      work = next;
+    }
+
+    current_strand() = outer;
+
+    // Give the underlying executor's other work a chance before running what has been queued up in the meantime
+    if (num_pending_.fetch_sub(num_run, MINICOROS_STD::memory_order_acq_rel) != num_run)
+      schedule_runner();
+  }
+
+  decltype(detail::capture_executor(MINICOROS_STD::declval<ExecutorType>())) executor_;
+  detail::intrusive_mpsc_queue<detail::work_node> queue_;
+  MINICOROS_STD::atomic<size_t> num_pending_{0};
+};
+
+template<typename ExecutorType>
+strand(ExecutorType&&) -> strand<ExecutorType>;
+
+} // mc
+
+#endif // MINICOROS_STRAND_H_
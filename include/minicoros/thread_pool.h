@@ -0,0 +1,228 @@
+/// Copyright (C) 2022 Electronic Arts Inc.  All rights reserved.
+
+#ifndef MINICOROS_THREAD_POOL_H_
+#define MINICOROS_THREAD_POOL_H_
+
+#ifdef MINICOROS_CUSTOM_INCLUDE
+  #include MINICOROS_CUSTOM_INCLUDE
+#endif
+
+#include <minicoros/detail/unique_work.h>
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#ifdef MINICOROS_USE_EASTL
+  #include <eastl/atomic.h>
+  #include <eastl/deque.h>
+  #include <eastl/unique_ptr.h>
+  #include <eastl/vector.h>
+
+  #ifndef MINICOROS_STD
+    #define MINICOROS_STD eastl
+  #endif
+#else
+  #include <atomic>
+  #include <deque>
+  #include <memory>
+  #include <vector>
+
+  #ifndef MINICOROS_STD
+    #define MINICOROS_STD std
+  #endif
+#endif
+
+namespace mc {
+
+/// Work-stealing thread pool, usable as an executor for `future::enqueue`:
+///
+/// ```cpp
+/// mc::thread_pool pool;
+/// read_file(path)
+///   .enqueue(pool)
+///   .then([](buffer&& b) {return parse(b); });
+/// ```
+///
+/// Each worker has its own deque. Work enqueued from a worker (typically the continuations of the work it's running)
+/// goes onto its own deque and is run newest first, while its data is still in the cache. Work enqueued from other
+/// threads goes onto a shared queue and is run oldest first. Idle workers steal the oldest work from the others.
+/// The pool runs the remaining work before its destructor returns, and has to outlive the futures enqueued on it.
+///
+/// The combinators (`&&`, `||`, `when_all`, `when_any`, ...) aren't synchronized: futures that are combined can't
+/// resolve on different workers at the same time. Enqueue them on a `strand` on top of the pool to combine them:
+///
+/// ```cpp
+/// mc::strand combine{pool};
+/// mc::when_all(fetch(a).enqueue(combine), fetch(b).enqueue(combine))
+///   .then([](blob&& a, blob&& b) {...});
+/// ```
+class thread_pool {
+public:
+  /// Defaults to one worker per hardware thread.
+  explicit thread_pool(size_t num_threads = default_num_threads()) {
+    num_threads = num_threads > 0 ? num_threads : 1;
+    workers_.reserve(num_threads);
+
+    for (size_t i = 0; i < num_threads; ++i)
+      workers_.push_back(MINICOROS_STD::unique_ptr<worker>(new worker));
+
+    for (size_t i = 0; i < workers_.size(); ++i)
+      workers_[i]->thread = std::thread([this, i] {run_worker(i); });
+  }
+
+  thread_pool(const thread_pool&) = delete;
+  thread_pool& operator =(const thread_pool&) = delete;
+
+  ~thread_pool() {
+    {
+      std::lock_guard<std::mutex> lock{sleep_mutex_};
+      stopping_ = true;
+    }
+
+    wake_.notify_all();
+
+    for (auto& w : workers_)
+      w->thread.join();
+  }
+
+  template<typename WorkType>
+  void operator ()(WorkType&& work) {
+    submit(detail::unique_work{MINICOROS_STD::forward<WorkType>(work)});
+  }
+
+  size_t size() const {
+    return workers_.size();
+  }
+
+  /// Whether the calling thread is one of the pool's workers.
+  bool running_in_this_thread() const {
+    return current_pool() == this;
+  }
+
+  static size_t default_num_threads() {
+    const unsigned num_threads = std::thread::hardware_concurrency();
+    return num_threads > 0 ? num_threads : 1;
+  }
+
+private:
+  struct worker {
+    std::mutex mutex;
+    MINICOROS_STD::deque<detail::unique_work> work;
+    std::thread thread;
+  };
+
+  /// The pool and worker index of the calling thread, if it's a worker.
+  static thread_pool*& current_pool() {
+    static thread_local thread_pool* pool = nullptr;
+    return pool;
+  }
+
+  static size_t& current_worker_index() {
+    static thread_local size_t index = 0;
+    return index;
+  }
+
+  void submit(detail::unique_work&& work) {
+    if (current_pool() == this) {
+      worker& self = *workers_[current_worker_index()];
+      std::lock_guard<std::mutex> lock{self.mutex};
+      self.work.push_back(MINICOROS_STD::move(work));
+    }
+    else {
+      std::lock_guard<std::mutex> lock{injected_mutex_};
+      injected_.push_back(MINICOROS_STD::move(work));
+    }
+
+    // Pairs with the worker bumping `sleepers_` before checking `pending_`: either it sees the new work, or we see
+    // that it's (about to go to) sleep and wake it up.
+    pending_.fetch_add(1);
+
+    if (sleepers_.load() > 0) {
+      std::lock_guard<std::mutex> lock{sleep_mutex_};
+      wake_.notify_one();
+    }
+  }
+
+  bool try_take(size_t index, detail::unique_work& out) {
+    {
+      worker& self = *workers_[index];
+      std::lock_guard<std::mutex> lock{self.mutex};
+
+      if (!self.work.empty()) {
+        out = MINICOROS_STD::move(self.work.back());
+        self.work.pop_back();
+        pending_.fetch_sub(1);
+        return true;
+      }
+    }
+
+    {
+      std::lock_guard<std::mutex> lock{injected_mutex_};
+
+      if (!injected_.empty()) {
+        out = MINICOROS_STD::move(injected_.front());
+        injected_.pop_front();
+        pending_.fetch_sub(1);
+        return true;
+      }
+    }
+
+    for (size_t i = 1; i < workers_.size(); ++i) {
+      worker& victim = *workers_[(index + i) % workers_.size()];
+      std::lock_guard<std::mutex> lock{victim.mutex};
+
+      if (!victim.work.empty()) {
+        out = MINICOROS_STD::move(victim.work.front());
+        victim.work.pop_front();
+        pending_.fetch_sub(1);
+        return true;
+      }
+    }
+
+    return false;
+  }
+
+  void run_worker(size_t index) {
+    current_pool() = this;
+    current_worker_index() = index;
+
+    for (;;) {
+      detail::unique_work work;
+
+      if (try_take(index, work)) {
+        work();
+        continue;
+      }
+
+      std::unique_lock<std::mutex> lock{sleep_mutex_};
+
+      // Everything has been run
+      if (stopping_)
+        break;
+
+      sleepers_.fetch_add(1);
+      wake_.wait(lock, [this] {return pending_.load() > 0 || stopping_; });
+      sleepers_.fetch_sub(1);
+    }
+
+    current_pool() = nullptr;
+  }
+
+  MINICOROS_STD::vector<MINICOROS_STD::unique_ptr<worker>> workers_;
+
+  std::mutex injected_mutex_;
+  MINICOROS_STD::deque<detail::unique_work> injected_;
+
+  /// Work that has been submitted but not taken yet. Can dip below zero for a moment, when work is taken before its
+  /// submitter got to count it.
+  MINICOROS_STD::atomic<ptrdiff_t> pending_{0};
+  MINICOROS_STD::atomic<size_t> sleepers_{0};
+  std::mutex sleep_mutex_;
+  std::condition_variable wake_;
+  bool stopping_ = false;
+};
+
+} // mc
+
+#endif // MINICOROS_THREAD_POOL_H_
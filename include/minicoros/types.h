@@ -13,7 +13,9 @@
   #include <eastl/optional.h>
   #include <eastl/type_traits.h>
   #include <eastl/tuple.h>
+  #include <eastl/chrono.h>
   #include <cassert>
+  #include <cstdint>
 
   #ifndef MINICOROS_STD
     #define MINICOROS_STD eastl
@@ -25,6 +27,8 @@
   #include <type_traits>
   #include <cassert>
   #include <tuple>
+  #include <chrono>
+  #include <cstdint>
 
   #ifndef MINICOROS_STD
     #define MINICOROS_STD std
@@ -35,6 +39,12 @@
   #define MINICOROS_ERROR_TYPE int
 #endif
 
+/// How many continuations `future::enqueue` runs nested inside each other when it's already on the executor's thread,
+/// before handing one to the executor to unwind the stack.
+#ifndef MINICOROS_MAX_INLINE_DEPTH
+  #define MINICOROS_MAX_INLINE_DEPTH 16
+#endif
+
 namespace mc {
 namespace detail {
 
@@ -171,6 +181,20 @@ struct failure {
   MINICOROS_ERROR_TYPE error;
 };
 
+/// How `mc::retry` spaces out its attempts. The delay before the second attempt is `initial_delay`, and each delay
+/// after that is `multiplier` times the previous one, up to `max_delay`. `jitter` is the fraction of each delay that
+/// is randomized away (0 waits the exact delay, 1 waits anywhere between nothing and the full delay), so that
+/// clients that failed at the same time don't all retry at the same time. `seed` seeds the random numbers; 0 picks a
+/// different seed for every retry, other seeds give the same delays every time (for tests).
+struct retry_policy {
+  size_t max_attempts = 3;
+  MINICOROS_STD::chrono::milliseconds initial_delay{100};
+  double multiplier = 2.0;
+  MINICOROS_STD::chrono::milliseconds max_delay{10000};
+  double jitter = 0.5;
+  uint64_t seed = 0;
+};
+
 /// Holds the actual resulting value of a callback (or the failure).
 template<typename T>
 class concrete_result {
@@ -0,0 +1,654 @@
+/// Copyright (C) 2022 Electronic Arts Inc.  All rights reserved.
+
+#include "testing.h"
+#include <minicoros/frame_executor.h>
+#include <minicoros/future.h>
+#include <minicoros/priority_executor.h>
+#include <minicoros/pump_executor.h>
+#include <minicoros/shard_group.h>
+#include <minicoros/strand.h>
+#include <minicoros/thread_pool.h>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace testing;
+using namespace mc;
+
+/// Waits for `condition` to become true, failing the test if it takes too long.
+template<typename ConditionType>
+void wait_for(ConditionType&& condition) {
+  const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds{10};
+
+  while (!condition()) {
+    if (std::chrono::steady_clock::now() > deadline)
+      TEST_FAIL("timed out");
+
+    std::this_thread::yield();
+  }
+}
+
+/// Executor that holds on to its work until told to run it.
+class manual_executor {
+public:
+  template<typename WorkType>
+  void operator ()(WorkType&& work) {
+    work_->push_back(detail::unique_work{std::forward<WorkType>(work)});
+  }
+
+  size_t run_all() {
+    std::vector<detail::unique_work> work = std::move(*work_);
+    work_->clear();
+
+    for (auto& item : work)
+      item();
+
+    return work.size();
+  }
+
+  size_t size() const {
+    return work_->size();
+  }
+
+private:
+  std::shared_ptr<std::vector<detail::unique_work>> work_ = std::make_shared<std::vector<detail::unique_work>>();
+};
+
+/// `manual_executor` that says it's running in this thread while it runs its work, like a single-threaded loop.
+class manual_loop : public manual_executor {
+public:
+  size_t run_all() {
+    *running_ = true;
+    const size_t count = manual_executor::run_all();
+    *running_ = false;
+    return count;
+  }
+
+  bool running_in_this_thread() const {
+    return *running_;
+  }
+
+private:
+  std::shared_ptr<bool> running_ = std::make_shared<bool>(false);
+};
+
+TEST(thread_pool, runs_continuations_on_worker_threads) {
+  thread_pool pool{2};
+  std::atomic<bool> done{false};
+  std::thread::id continuation_thread;
+
+  make_successful_future<int>(123)
+    .enqueue(pool)
+    .then([&](int value) {
+      ASSERT_EQ(value, 123);
+      continuation_thread = std::this_thread::get_id();
+      done = true;
+    })
+    .ignore_result();
+
+  wait_for([&] {return done.load(); });
+  ASSERT_TRUE((continuation_thread != std::this_thread::get_id()));
+}
+
+TEST(thread_pool, runs_all_work_before_destruction) {
+  std::atomic<int> count{0};
+
+  {
+    thread_pool pool{4};
+
+    for (int i = 0; i < 10000; ++i)
+      pool([&] {++count; });
+  }
+
+  ASSERT_EQ(count.load(), 10000);
+}
+
+TEST(thread_pool, runs_work_submitted_from_workers) {
+  std::atomic<int> count{0};
+
+  {
+    thread_pool pool{4};
+
+    for (int i = 0; i < 1000; ++i) {
+      pool([&] {
+        ++count;
+        pool([&] {++count; });
+      });
+    }
+  }
+
+  ASSERT_EQ(count.load(), 2000);
+}
+
+TEST(thread_pool, runs_move_only_work) {
+  std::atomic<int> value{0};
+
+  {
+    thread_pool pool{1};
+    auto owned = std::make_unique<int>(123);
+    pool([&value, owned = std::move(owned)] {value = *owned; });
+  }
+
+  ASSERT_EQ(value.load(), 123);
+}
+
+TEST(thread_pool, chains_hop_between_threads) {
+  thread_pool pool{4};
+  std::atomic<bool> done{false};
+
+  make_successful_future<int>(0)
+    .enqueue(pool)
+    .then([](int value) -> mc::result<int> {return value + 1; })
+    .enqueue(pool)
+    .then([](int value) -> mc::result<std::string> {return std::to_string(value + 1); })
+    .enqueue(pool)
+    .then([&](std::string&& value) {
+      ASSERT_EQ(value, "2");
+      done = true;
+    })
+    .ignore_result();
+
+  wait_for([&] {return done.load(); });
+}
+
+TEST(strand, runs_queued_work_in_one_activation) {
+  manual_executor executor;
+  strand s{executor};
+  std::vector<int> order;
+
+  s([&] {order.push_back(1); });
+  s([&] {order.push_back(2); });
+  s([&] {order.push_back(3); });
+
+  ASSERT_EQ(executor.size(), 1);
+  ASSERT_EQ(executor.run_all(), 1);
+  ASSERT_EQ(order.size(), 3);
+  ASSERT_EQ(order[0], 1);
+  ASSERT_EQ(order[1], 2);
+  ASSERT_EQ(order[2], 3);
+  ASSERT_EQ(executor.size(), 0);
+}
+
+TEST(strand, work_queued_while_running_gets_a_new_activation) {
+  manual_executor executor;
+  strand s{executor};
+  std::vector<int> order;
+
+  s([&] {
+    order.push_back(1);
+    s([&] {order.push_back(2); });
+  });
+
+  executor.run_all();
+  ASSERT_EQ(order.size(), 1);
+  ASSERT_EQ(executor.size(), 1);
+
+  executor.run_all();
+  ASSERT_EQ(order.size(), 2);
+  ASSERT_EQ(order[1], 2);
+}
+
+TEST(strand, serializes_work_on_a_thread_pool) {
+  constexpr int num_producers = 4;
+  constexpr int num_items_per_producer = 2000;
+
+  thread_pool pool{4};
+  strand s{pool};
+  std::atomic<bool> running{false};
+  std::atomic<int> num_done{0};
+  int unsynchronized_count = 0;
+
+  std::vector<std::thread> producers;
+  for (int i = 0; i < num_producers; ++i) {
+    producers.emplace_back([&] {
+      for (int j = 0; j < num_items_per_producer; ++j) {
+        s([&] {
+          ASSERT_FALSE(running.exchange(true));
+          ++unsynchronized_count;
+          running = false;
+          ++num_done;
+        });
+      }
+    });
+  }
+
+  for (auto& producer : producers)
+    producer.join();
+
+  wait_for([&] {return num_done.load() == num_producers * num_items_per_producer; });
+  ASSERT_EQ(unsynchronized_count, num_producers * num_items_per_producer);
+}
+
+TEST(strand, plugs_into_enqueue) {
+  manual_executor executor;
+  strand s{executor};
+  auto value = std::make_shared<int>();
+
+  make_successful_future<int>(123)
+    .enqueue(s)
+    .then([value](int v) {*value = v; })
+    .ignore_result();
+
+  ASSERT_EQ(*value, 0);
+  executor.run_all();
+  ASSERT_EQ(*value, 123);
+}
+
+TEST(shard_group, submit_to_runs_on_the_given_shard) {
+  shard_group group{2};
+  std::atomic<size_t> shard{shard_group::no_shard};
+
+  group.submit_to(1, [&] {return group.current_shard(); })
+    .then([&](size_t value) {shard = value; })
+    .ignore_result();
+
+  wait_for([&] {return shard.load() != shard_group::no_shard; });
+  ASSERT_EQ(shard.load(), 1);
+  ASSERT_EQ(group.current_shard(), shard_group::no_shard);
+}
+
+TEST(shard_group, resolves_back_on_the_calling_shard) {
+  shard_group group{2, 1024, false};
+  std::atomic<bool> done{false};
+
+  group.shard(0)([&] {
+    group.submit_to(1, [&] {return make_successful_future<int>(int(group.current_shard())); })
+      .then([&](int value) {
+        ASSERT_EQ(value, 1);
+        ASSERT_EQ(group.current_shard(), 0);
+        done = true;
+      })
+      .ignore_result();
+  });
+
+  wait_for([&] {return done.load(); });
+}
+
+TEST(shard_group, overflowing_rings_fall_back_to_shared_queue) {
+  constexpr int num_requests = 1000;
+  std::atomic<int> num_replies{0};
+  int sum = 0; // Only touched on shard 0
+
+  {
+    shard_group group{2, 4, false};
+
+    group.shard(0)([&] {
+      for (int i = 0; i < num_requests; ++i) {
+        group.submit_to(1, [i] {return i; })
+          .then([&](int value) {
+            sum += value;
+            ++num_replies;
+          })
+          .ignore_result();
+      }
+    });
+  }
+
+  // The destructor waits for the replies too
+  ASSERT_EQ(num_replies.load(), num_requests);
+  ASSERT_EQ(sum, num_requests * (num_requests - 1) / 2);
+}
+
+TEST(shard_group, plugs_into_enqueue) {
+  shard_group group{2, 1024, false};
+  std::atomic<size_t> shard{shard_group::no_shard};
+
+  make_successful_future<void>()
+    .enqueue(group.shard(1))
+    .then([&] {shard = group.current_shard(); })
+    .ignore_result();
+
+  wait_for([&] {return shard.load() != shard_group::no_shard; });
+  ASSERT_EQ(shard.load(), 1);
+}
+
+TEST(pump_executor, runs_work_from_other_threads_when_pumped) {
+  constexpr int num_producers = 4;
+  constexpr int num_items_per_producer = 1000;
+
+  pump_executor main_thread;
+  std::vector<std::vector<int>> received(num_producers);
+
+  std::vector<std::thread> producers;
+  for (int i = 0; i < num_producers; ++i) {
+    producers.emplace_back([&, i] {
+      for (int j = 0; j < num_items_per_producer; ++j)
+        main_thread([&, i, j] {received[i].push_back(j); });
+    });
+  }
+
+  for (auto& producer : producers)
+    producer.join();
+
+  ASSERT_EQ(received[0].size(), 0);
+  ASSERT_EQ(main_thread.pump(), num_producers * num_items_per_producer);
+
+  // In order per producer
+  for (auto& values : received) {
+    ASSERT_EQ(values.size(), num_items_per_producer);
+
+    for (int j = 0; j < num_items_per_producer; ++j)
+      ASSERT_EQ(values[j], j);
+  }
+}
+
+TEST(pump_executor, work_given_while_pumping_waits_for_next_pump) {
+  pump_executor main_thread;
+  int count = 0;
+
+  main_thread([&] {
+    ++count;
+    main_thread([&] {++count; });
+  });
+
+  ASSERT_EQ(main_thread.pump(), 1);
+  ASSERT_EQ(count, 1);
+  ASSERT_EQ(main_thread.pump(), 1);
+  ASSERT_EQ(count, 2);
+  ASSERT_EQ(main_thread.pump(), 0);
+}
+
+TEST(pump_executor, defers_continuations_resolved_on_the_owner_outside_of_pump) {
+  pump_executor main_thread;
+  auto value = std::make_shared<int>();
+
+  make_successful_future<int>(123)
+    .enqueue(main_thread)
+    .then([](int v) -> mc::result<int> {return v + 1; })
+    .enqueue(main_thread)
+    .then([value](int v) {*value = v; })
+    .ignore_result();
+
+  ASSERT_EQ(*value, 0);
+
+  // The second hop is made while pumping, so it runs right away
+  ASSERT_EQ(main_thread.pump(), 1);
+  ASSERT_EQ(*value, 124);
+}
+
+TEST(pump_executor, brings_continuations_back_to_the_owner) {
+  pump_executor main_thread;
+  thread_pool pool{2};
+  std::thread::id continuation_thread;
+  bool done = false;
+
+  make_successful_future<int>(123)
+    .enqueue(pool)
+    .then([](int value) -> mc::result<int> {return value + 1; })
+    .enqueue(main_thread)
+    .then([&](int value) {
+      ASSERT_EQ(value, 124);
+      continuation_thread = std::this_thread::get_id();
+      done = true;
+    })
+    .ignore_result();
+
+  wait_for([&] {
+    main_thread.pump();
+    return done;
+  });
+
+  ASSERT_TRUE((continuation_thread == std::this_thread::get_id()));
+}
+
+/// Clock that only moves when told to.
+struct fake_clock {
+  using duration = std::chrono::milliseconds;
+  using rep = duration::rep;
+  using period = duration::period;
+  using time_point = std::chrono::time_point<fake_clock>;
+  static constexpr bool is_steady = true;
+
+  static time_point now() {
+    return time_point{current};
+  }
+
+  static inline duration current{0};
+};
+
+TEST(frame_executor, runs_work_until_budget_is_used_up) {
+  frame_executor<fake_clock> frame;
+  int count = 0;
+
+  for (int i = 0; i < 5; ++i) {
+    frame([&] {
+      ++count;
+      fake_clock::current += std::chrono::milliseconds{4};
+    });
+  }
+
+  auto stats = frame.run_for(std::chrono::milliseconds{10});
+  ASSERT_EQ(count, 3);
+  ASSERT_EQ(stats.num_run, 3);
+  ASSERT_EQ(stats.num_deferred, 2);
+  ASSERT_EQ(stats.elapsed.count(), 12);
+
+  stats = frame.run_for(std::chrono::milliseconds{100});
+  ASSERT_EQ(count, 5);
+  ASSERT_EQ(stats.num_run, 2);
+  ASSERT_EQ(stats.num_deferred, 0);
+}
+
+TEST(frame_executor, work_given_during_a_frame_waits_for_the_next) {
+  frame_executor<fake_clock> frame;
+  int count = 0;
+
+  frame([&] {
+    ++count;
+    frame([&] {++count; });
+  });
+
+  auto stats = frame.run_for(std::chrono::milliseconds{10});
+  ASSERT_EQ(count, 1);
+  ASSERT_EQ(stats.num_deferred, 1);
+
+  frame.run_for(std::chrono::milliseconds{10});
+  ASSERT_EQ(count, 2);
+}
+
+TEST(frame_executor, skips_estimated_work_that_does_not_fit) {
+  frame_executor<fake_clock> frame{true};
+  std::vector<int> order;
+
+  auto work = [&](int id, int cost) {
+    return [&, id, cost] {
+      order.push_back(id);
+      fake_clock::current += std::chrono::milliseconds{cost};
+    };
+  };
+
+  frame.with_cost(std::chrono::milliseconds{5})(work(1, 5));
+  frame.with_cost(std::chrono::milliseconds{8})(work(2, 8));
+  frame.with_cost(std::chrono::milliseconds{1})(work(3, 1));
+
+  auto stats = frame.run_for(std::chrono::milliseconds{10});
+  ASSERT_EQ(stats.num_run, 2);
+  ASSERT_EQ(stats.num_deferred, 1);
+  ASSERT_EQ(order.size(), 2);
+  ASSERT_EQ(order[0], 1);
+  ASSERT_EQ(order[1], 3);
+
+  // First in the next frame, so it runs even though it's close to the budget
+  frame.run_for(std::chrono::milliseconds{8});
+  ASSERT_EQ(order.size(), 3);
+  ASSERT_EQ(order[2], 2);
+}
+
+TEST(frame_executor, plugs_into_enqueue) {
+  frame_executor<> frame;
+  auto value = std::make_shared<int>();
+
+  make_successful_future<int>(123)
+    .enqueue(frame.with_cost(std::chrono::milliseconds{1}))
+    .then([value](int v) {*value = v; })
+    .ignore_result();
+
+  ASSERT_EQ(*value, 0);
+  frame.run_for(std::chrono::seconds{10});
+  ASSERT_EQ(*value, 123);
+}
+
+TEST(priority_executor, runs_higher_priorities_first) {
+  manual_executor executor;
+  priority_executor lanes{executor, 2};
+  std::vector<int> order;
+
+  with_priority(lanes, 1)([&] {order.push_back(1); });
+  with_priority(lanes, 1)([&] {order.push_back(2); });
+  with_priority(lanes, 0)([&] {order.push_back(3); });
+
+  ASSERT_EQ(executor.run_all(), 3);
+  ASSERT_EQ(order.size(), 3);
+  ASSERT_EQ(order[0], 3);
+  ASSERT_EQ(order[1], 1);
+  ASSERT_EQ(order[2], 2);
+}
+
+TEST(priority_executor, lanes_passed_over_too_often_go_first) {
+  manual_executor executor;
+  priority_executor lanes{executor, 2, 2};
+  std::vector<int> order;
+
+  with_priority(lanes, 1)([&] {order.push_back(0); });
+
+  for (int i = 1; i <= 4; ++i)
+    with_priority(lanes, 0)([&order, i] {order.push_back(i); });
+
+  executor.run_all();
+  ASSERT_EQ(order.size(), 5);
+  ASSERT_EQ(order[0], 1);
+  ASSERT_EQ(order[1], 2);
+  ASSERT_EQ(order[2], 0);
+  ASSERT_EQ(order[3], 3);
+  ASSERT_EQ(order[4], 4);
+}
+
+TEST(priority_executor, runs_all_work_on_a_thread_pool) {
+  constexpr int num_items = 2000;
+
+  thread_pool pool{4};
+  priority_executor lanes{pool};
+  std::atomic<int> num_done{0};
+
+  for (int i = 0; i < num_items; ++i)
+    with_priority(lanes, static_cast<size_t>(i) % lanes.num_lanes())([&] {++num_done; });
+
+  wait_for([&] {return num_done.load() == num_items; });
+}
+
+TEST(priority_executor, plugs_into_enqueue) {
+  manual_executor executor;
+  priority_executor lanes{executor};
+  auto value = std::make_shared<int>();
+
+  make_successful_future<int>(123)
+    .enqueue(with_priority(lanes, 0))
+    .then([value](int v) {*value = v; })
+    .ignore_result();
+
+  ASSERT_EQ(*value, 0);
+  executor.run_all();
+  ASSERT_EQ(*value, 123);
+}
+
+TEST(enqueue, consecutive_enqueues_onto_the_same_executor_hop_once) {
+  manual_loop loop;
+  auto value = std::make_shared<int>();
+
+  make_successful_future<int>(123)
+    .enqueue(loop)
+    .then([](int v) -> mc::result<int> {return v + 1; })
+    .enqueue(loop)
+    .enqueue(loop)
+    .then([value](int v) {*value = v; })
+    .ignore_result();
+
+  ASSERT_EQ(loop.run_all(), 1);
+  ASSERT_EQ(*value, 124);
+  ASSERT_EQ(loop.size(), 0);
+}
+
+/// Enqueues `f` onto `loop` `count` times, counting the hops.
+static future<int> enqueue_repeatedly(future<int>&& f, manual_loop& loop, int count) {
+  if (count == 0)
+    return std::move(f);
+
+  return enqueue_repeatedly(std::move(f).enqueue(loop).then([](int v) -> mc::result<int> {return v + 1; }), loop, count - 1);
+}
+
+TEST(enqueue, inline_continuations_are_depth_limited) {
+  manual_loop loop;
+  auto value = std::make_shared<int>();
+
+  enqueue_repeatedly(make_successful_future<int>(0), loop, 2 * MINICOROS_MAX_INLINE_DEPTH + 8)
+    .then([value](int v) {*value = v; })
+    .ignore_result();
+
+  // One hop onto the loop, then another each time the depth limit is reached
+  ASSERT_EQ(loop.run_all(), 1);
+  ASSERT_EQ(loop.run_all(), 1);
+  ASSERT_EQ(loop.run_all(), 1);
+  ASSERT_EQ(loop.run_all(), 0);
+  ASSERT_EQ(*value, 2 * MINICOROS_MAX_INLINE_DEPTH + 8);
+}
+
+TEST(enqueue, stays_on_the_thread_pool_worker) {
+  thread_pool pool{4};
+  std::thread::id first;
+  std::thread::id second;
+  std::atomic<bool> done{false};
+
+  make_successful_future<int>(123)
+    .enqueue(pool)
+    .then([&](int v) -> mc::result<int> {
+      first = std::this_thread::get_id();
+      return v;
+    })
+    .enqueue(pool)
+    .then([&](int) {
+      second = std::this_thread::get_id();
+      done = true;
+    })
+    .ignore_result();
+
+  wait_for([&] {return done.load(); });
+  ASSERT_TRUE((first == second));
+}
+
+TEST(enqueue, stays_on_the_strand) {
+  manual_executor executor;
+  strand s{executor};
+  auto value = std::make_shared<int>();
+
+  make_successful_future<int>(123)
+    .enqueue(s)
+    .then([](int v) -> mc::result<int> {return v + 1; })
+    .enqueue(s)
+    .then([value](int v) {*value = v; })
+    .ignore_result();
+
+  ASSERT_EQ(executor.run_all(), 1);
+  ASSERT_EQ(*value, 124);
+  ASSERT_EQ(executor.size(), 0);
+}
+
+TEST(strand, queues_work_with_one_allocation) {
+  manual_executor executor;
+  strand s{executor};
+  int count = 0;
+
+  // The first work also schedules the runner
+  s([&] {++count; });
+
+  {
+    alloc_counter allocs;
+    s([&] {++count; });
+    ASSERT_EQ(allocs.total_allocation_count(), 1);
+  }
+
+  ASSERT_EQ(executor.run_all(), 1);
+  ASSERT_EQ(count, 2);
+}
@@ -3,8 +3,10 @@
 #include "testing.h"
 #include <minicoros/future.h>
 #include <minicoros/testing.h>
+#include <atomic>
 #include <memory>
 #include <string>
+#include <thread>
 #include <vector>
 
 using namespace testing;
@@ -458,6 +460,50 @@ TEST(future, andand_supports_void) {
   }
 }
 
+TEST(future, andand_composes_flat) {
+  using namespace mc;
+
+  auto fut = make_successful_future<int>(123) && make_successful_future<std::string>("hello") && make_successful_future<void>() && make_successful_future<bool>(true);
+  static_assert(std::is_same_v<decltype(fut), future<int, std::string, void, bool>>);
+  static_assert(std::is_same_v<decltype(fut)::type, std::tuple<int, std::string, bool>>);
+
+  auto call_count = std::make_shared<int>();
+
+  std::move(fut)
+    .then([call_count](int i, std::string s, bool b) {
+      ASSERT_EQ(i, 123);
+      ASSERT_EQ(s, "hello");
+      ASSERT_EQ(b, true);
+      ++*call_count;
+    })
+    .ignore_result();
+
+  ASSERT_EQ(*call_count, 1);
+}
+
+TEST(future, andand_composition_is_lazy_and_evaluated_on_destruction) {
+  using namespace mc;
+
+  mc::promise<int> p1;
+  mc::promise<void> p2;
+
+  {
+    auto composition = future<int>([&](promise<int> p) {p1 = std::move(p); }) && future<void>([&](promise<void> p) {p2 = std::move(p); });
+    ASSERT_FALSE(bool{p1});
+    ASSERT_FALSE(bool{p2});
+  }
+
+  ASSERT_TRUE(bool{p1});
+  ASSERT_TRUE(bool{p2});
+}
+
+TEST(future, andand_composition_can_be_raced) {
+  using namespace mc;
+
+  future<std::tuple<int, bool>> fut = (make_successful_future<int>(123) && make_successful_future<bool>(true)) || make_failed_future<std::tuple<int, bool>>(444);
+  assert_successful_result_eq(std::move(fut), {123, true});
+}
+
 class type_without_copy_assignment
 {
 public:
@@ -535,6 +581,89 @@ TEST(future, oror_handles_delayed_results) {
 }
 
 
+TEST(future, oror_cancels_the_loser) {
+  using namespace mc;
+
+  promise<int> p1, p2;
+  bool loser_continued = false;
+
+  auto coro1 = future<int>([&](promise<int> p) {p1 = std::move(p); });
+  auto coro2 = future<int>([&](promise<int> p) {p2 = std::move(p); })
+    .then([&](int value) -> mc::result<int> {
+      loser_continued = true;
+      return value;
+    });
+
+  (std::move(coro1) || std::move(coro2)).ignore_result();
+
+  p1(123);
+  p2(444);
+  ASSERT_FALSE(loser_continued);
+}
+
+TEST(future, andand_failure_cancels_the_other_operand) {
+  using namespace mc;
+
+  promise<int> p1, p2;
+  bool other_continued = false;
+
+  auto coro1 = future<int>([&](promise<int> p) {p1 = std::move(p); });
+  auto coro2 = future<int>([&](promise<int> p) {p2 = std::move(p); })
+    .then([&](int value) -> mc::result<int> {
+      other_continued = true;
+      return value;
+    });
+
+  (std::move(coro1) && std::move(coro2)).ignore_result();
+
+  p1(failure{123});
+  p2(444);
+  ASSERT_FALSE(other_continued);
+}
+
+TEST(future, make_future_resolved_before_evaluation) {
+  auto [fut, p] = mc::make_future<int>();
+  p(123);
+  assert_successful_result_eq(std::move(fut), 123);
+}
+
+TEST(future, make_future_resolved_after_evaluation) {
+  auto [fut, p] = mc::make_future<int>();
+  auto value = std::make_shared<int>();
+
+  std::move(fut).then([value](int v) {*value = v; }).ignore_result();
+  ASSERT_EQ(*value, 0);
+  p(123);
+  ASSERT_EQ(*value, 123);
+}
+
+TEST(future, make_future_ignores_repeated_resolves) {
+  auto [fut, p] = mc::make_future<int>();
+  auto num_calls = std::make_shared<int>();
+
+  std::move(fut).then([num_calls](int v) {
+    ASSERT_EQ(v, 1);
+    ++*num_calls;
+  }).ignore_result();
+
+  p(1);
+  p(2);
+  ASSERT_EQ(*num_calls, 1);
+}
+
+TEST(future, make_future_can_be_resolved_from_another_thread) {
+  for (int i = 0; i < 1000; ++i) {
+    auto [fut, p] = mc::make_future<int>();
+    auto sum = std::make_shared<std::atomic<int>>(0);
+
+    std::thread resolver([p = std::move(p), i] () mutable {p(int{i}); });
+    std::move(fut).then([sum](int v) {*sum += v + 1; }).ignore_result();
+    resolver.join();
+
+    ASSERT_EQ(sum->load(), i + 1);
+  }
+}
+
 mc::future<void> make_future(mc::promise<void>& p) {
   return mc::future<void>([&](mc::promise<void> new_promise) {p = std::move(new_promise); });
 }
@@ -3,13 +3,40 @@
 #include "testing.h"
 #include <minicoros/operations.h>
 #include <minicoros/testing.h>
+#include <chrono>
+#include <functional>
+#include <iterator>
 #include <memory>
+#include <optional>
 #include <string>
+#include <tuple>
+#include <type_traits>
+#include <variant>
 #include <vector>
 
 using namespace testing;
 using namespace mc;
 
+/// Input iterator that creates successful futures on the fly, for testing lazily evaluated ranges.
+class future_generator {
+public:
+  using iterator_category = std::input_iterator_tag;
+  using value_type = future<int>;
+  using difference_type = std::ptrdiff_t;
+  using pointer = void;
+  using reference = future<int>;
+
+  explicit future_generator(int value) : value_(value) {}
+
+  future<int> operator *() const {return make_successful_future<int>(int{value_}); }
+  future_generator& operator ++() {++value_; return *this; }
+  bool operator ==(const future_generator& other) const {return value_ == other.value_; }
+  bool operator !=(const future_generator& other) const {return value_ != other.value_; }
+
+private:
+  int value_;
+};
+
 TEST(operations_when_all, vector_of_successful_futures_returns_successfully) {
   std::vector<future<int>> v;
   v.push_back(make_successful_future<int>(123));
@@ -44,6 +71,25 @@ TEST(operations_when_all, resolving_promises_in_reverse_order_remaps_values) {
   ASSERT_TRUE(*called);
 }
 
+TEST(operations_when_all, failure_cancels_remaining_futures) {
+  promise<int> p1, p2;
+  bool sibling_continued = false;
+
+  std::vector<future<int>> v;
+  v.push_back(future<int>([&](promise<int> p) {p1 = std::move(p); }));
+  v.push_back(future<int>([&](promise<int> p) {p2 = std::move(p); })
+    .then([&](int value) -> mc::result<int> {
+      sibling_continued = true;
+      return value;
+    }));
+
+  when_all(std::move(v)).ignore_result();
+
+  p1(failure{444});
+  p2(123);
+  ASSERT_FALSE(sibling_continued);
+}
+
 TEST(operations_when_all, empty_vector_returns_immediately) {
   std::vector<future<int>> v;
   assert_successful_result_eq(when_all(std::move(v)), {});
@@ -64,6 +110,180 @@ TEST(operations_when_all, takes_void) {
   assert_successful_result(when_all(std::move(v)));
 }
 
+TEST(operations_when_all, small_fan_outs_store_chains_inline) {
+  std::vector<future<int>> v;
+  v.push_back(make_successful_future<int>(123));
+  v.push_back(make_successful_future<int>(444));
+
+  alloc_counter allocs;
+  auto fut = when_all(std::move(v));
+
+  // Only the future itself is allocated
+  ASSERT_EQ(allocs.total_allocation_count(), 1);
+  assert_successful_result_eq(std::move(fut), {123, 444});
+}
+
+TEST(operations_when_all, large_fan_outs_return_all_values) {
+  std::vector<future<int>> v;
+  std::vector<int> expected;
+
+  for (int i = 0; i < MINICOROS_SMALL_VECTOR_SIZE * 3; ++i) {
+    v.push_back(make_successful_future<int>(int{i}));
+    expected.push_back(i);
+  }
+
+  assert_successful_result_eq(when_all(std::move(v)), std::move(expected));
+}
+
+TEST(operations_when_all, takes_array) {
+  future<int> futures[] = {make_successful_future<int>(123), make_successful_future<int>(444)};
+  assert_successful_result_eq(when_all(std::move(futures)), {123, 444});
+}
+
+TEST(operations_when_all, takes_iterator_range) {
+  std::vector<future<int>> v;
+  v.push_back(make_successful_future<int>(123));
+  v.push_back(make_successful_future<int>(444));
+  v.push_back(make_successful_future<int>(555));
+  assert_successful_result_eq(when_all(std::make_move_iterator(v.begin() + 1), std::make_move_iterator(v.end())), {444, 555});
+  assert_successful_result_eq(when_all(std::make_move_iterator(v.begin()), std::make_move_iterator(v.begin() + 1)), {123});
+}
+
+/// Whether `when_all` can be called with arguments of the types in the tuple.
+template<typename ArgsType, typename = void>
+struct when_all_accepts : std::false_type {};
+
+template<typename... ArgTypes>
+struct when_all_accepts<std::tuple<ArgTypes...>, std::void_t<decltype(when_all(std::declval<ArgTypes>()...))>> : std::true_type {};
+
+TEST(operations_when_all, does_not_take_futures_it_would_leave_moved_from) {
+  using vector_type = std::vector<future<int>>;
+  using iterator_type = vector_type::iterator;
+
+  ASSERT_TRUE((when_all_accepts<std::tuple<vector_type&&>>::value));
+  ASSERT_FALSE((when_all_accepts<std::tuple<vector_type&>>::value));
+  ASSERT_TRUE((when_all_accepts<std::tuple<std::move_iterator<iterator_type>, std::move_iterator<iterator_type>>>::value));
+  ASSERT_FALSE((when_all_accepts<std::tuple<iterator_type, iterator_type>>::value));
+}
+
+TEST(operations_when_all, takes_lazily_created_futures) {
+  assert_successful_result_eq(when_all(future_generator{1}, future_generator{4}), {1, 2, 3});
+}
+
+/// Memory resource that counts the allocations it forwards to the default resource.
+class counting_resource : public memory_resource {
+public:
+  int num_allocations = 0;
+  int num_deallocations = 0;
+
+private:
+  void* do_allocate(size_t bytes, size_t alignment) override {
+    ++num_allocations;
+    return detail::new_delete_resource()->allocate(bytes, alignment);
+  }
+
+  void do_deallocate(void* p, size_t bytes, size_t alignment) override {
+    ++num_deallocations;
+    detail::new_delete_resource()->deallocate(p, bytes, alignment);
+  }
+
+  bool do_is_equal(const memory_resource& other) const noexcept override {
+    return this == &other;
+  }
+};
+
+TEST(operations_allocator_scope, when_all_allocates_from_scoped_resource) {
+  counting_resource resource;
+  std::optional<future<std::vector<int>>> fut;
+
+  {
+    allocator_scope scope{resource};
+
+    std::vector<future<int>> v;
+    for (int i = 0; i < MINICOROS_SMALL_VECTOR_SIZE + 1; ++i)
+      v.push_back(make_successful_future<int>(int{i}));
+
+    fut.emplace(when_all(std::move(v)));
+  }
+
+  // The chains outgrew the inline storage
+  ASSERT_EQ(resource.num_allocations, 1);
+
+  // The resource is the one that was current when `when_all` was called, not when it's evaluated
+  assert_successful_result_eq(std::move(*fut), {0, 1, 2, 3, 4, 5, 6, 7, 8});
+  ASSERT_EQ(resource.num_allocations, 2);
+  ASSERT_EQ(resource.num_deallocations, 2);
+}
+
+TEST(operations_allocator_scope, innermost_scope_wins) {
+  counting_resource outer, inner;
+  allocator_scope outer_scope{outer};
+
+  {
+    allocator_scope inner_scope{inner};
+    assert_successful_result_eq(make_successful_future<int>(1) || make_successful_future<int>(2), 1);
+  }
+
+  ASSERT_EQ(inner.num_allocations, 1);
+  ASSERT_EQ(outer.num_allocations, 0);
+}
+
+TEST(operations_when_all_variadic, mixed_types_resolve_to_flat_tuple) {
+  future<std::tuple<int, std::string, bool>> fut = when_all(
+    make_successful_future<int>(123),
+    make_successful_future<std::string>("hello"),
+    make_successful_future<bool>(true));
+
+  assert_successful_result_eq(std::move(fut), {123, std::string{"hello"}, true});
+}
+
+TEST(operations_when_all_variadic, void_values_are_left_out) {
+  future<std::tuple<int, bool>> fut = when_all(make_successful_future<void>(), make_successful_future<int>(123), make_successful_future<bool>(true));
+  assert_successful_result_eq(std::move(fut), {123, true});
+
+  future<int> fut2 = when_all(make_successful_future<void>(), make_successful_future<int>(123), make_successful_future<void>());
+  assert_successful_result_eq(std::move(fut2), 123);
+
+  future<void> fut3 = when_all(make_successful_future<void>(), make_successful_future<void>());
+  assert_successful_result(std::move(fut3));
+}
+
+TEST(operations_when_all_variadic, tuple_values_are_concatenated) {
+  auto operand = make_successful_future<int>(123) && make_successful_future<std::string>("hello");
+  future<std::tuple<int, std::string, bool>> fut = when_all(std::move(operand), make_successful_future<bool>(true));
+  assert_successful_result_eq(std::move(fut), {123, std::string{"hello"}, true});
+}
+
+TEST(operations_when_all_variadic, resolves_when_last_future_resolves) {
+  promise<int> p1;
+  promise<std::string> p2;
+  promise<void> p3;
+  auto called = std::make_shared<bool>();
+
+  when_all(
+    future<int>([&](promise<int> p) {p1 = std::move(p); }),
+    future<std::string>([&](promise<std::string> p) {p2 = std::move(p); }),
+    future<void>([&](promise<void> p) {p3 = std::move(p); }))
+    .then([called](int i, std::string s) {
+      ASSERT_EQ(i, 123);
+      ASSERT_EQ(s, "hello");
+      *called = true;
+    })
+    .ignore_result();
+
+  p3({});
+  p2(std::string{"hello"});
+  ASSERT_FALSE(*called);
+
+  p1(123);
+  ASSERT_TRUE(*called);
+}
+
+TEST(operations_when_all_variadic, failure_is_propagated) {
+  future<std::tuple<int, bool>> fut = when_all(make_successful_future<int>(4), make_failed_future<void>(444), make_failed_future<bool>(456));
+  assert_fail_eq(std::move(fut), 444);
+}
+
 TEST(operations_when_any, resolves_to_first_value) {
   promise<int> p1, p2;
   bool called = false;
@@ -127,6 +347,243 @@ TEST(operations_when_any, supports_void) {
   assert_successful_result(std::move(fut));
 }
 
+TEST(operations_when_any, takes_iterator_range) {
+  assert_successful_result_eq(when_any(future_generator{7}, future_generator{9}), 7);
+}
+
+TEST(operations_when_any, cancels_remaining_futures) {
+  promise<int> p1, p2;
+  bool loser_continued = false;
+
+  std::vector<future<int>> c;
+  c.push_back(future<int>([&](promise<int> p) {p1 = std::move(p); }));
+  c.push_back(future<int>([&](promise<int> p) {p2 = std::move(p); })
+    .then([&](int value) -> mc::result<int> {
+      loser_continued = true;
+      return value;
+    }));
+
+  int result = 0;
+  when_any(std::move(c))
+    .then([&](int value) {result = value; })
+    .ignore_result();
+
+  p1(444);
+  ASSERT_EQ(result, 444);
+
+  p2(123);
+  ASSERT_FALSE(loser_continued);
+}
+
+TEST(operations_when_any, skips_finally_of_cancelled_futures_and_releases_them_when_they_resolve) {
+  promise<int> p1, p2;
+  bool loser_finalized = false;
+  auto loser_capture = std::make_shared<int>();
+  std::weak_ptr<int> loser_released = loser_capture;
+
+  std::vector<future<int>> c;
+  c.push_back(future<int>([&](promise<int> p) {p1 = std::move(p); }));
+  c.push_back(future<int>([&](promise<int> p) {p2 = std::move(p); })
+    .finally([&, loser_capture = std::move(loser_capture)](concrete_result<int> result) {
+      loser_finalized = true;
+      return result;
+    }));
+
+  when_any(std::move(c)).ignore_result();
+
+  p1(444);
+  ASSERT_FALSE(loser_released.expired());
+
+  p2(123);
+  ASSERT_FALSE(loser_finalized);
+  p2 = nullptr;
+  ASSERT_TRUE(loser_released.expired());
+}
+
+TEST(operations_when_any, cancellation_reaches_nested_combinators) {
+  promise<int> p1, p2;
+  bool inner_continued = false;
+
+  std::vector<future<int>> inner;
+  inner.push_back(future<int>([&](promise<int> p) {p2 = std::move(p); })
+    .then([&](int value) -> mc::result<int> {
+      inner_continued = true;
+      return value;
+    }));
+
+  std::vector<future<int>> outer;
+  outer.push_back(future<int>([&](promise<int> p) {p1 = std::move(p); }));
+  outer.push_back(when_all(std::move(inner)).then([](std::vector<int> values) -> mc::result<int> {return values[0]; }));
+
+  when_any(std::move(outer)).ignore_result();
+
+  p1(444);
+  p2(123);
+  ASSERT_FALSE(inner_continued);
+}
+
+TEST(operations_when_any, does_not_cancel_what_comes_after_it) {
+  promise<int> p1;
+  promise<std::string> p2;
+  std::string result;
+
+  std::vector<future<int>> c;
+  c.push_back(future<int>([&](promise<int> p) {p1 = std::move(p); }));
+  c.push_back(future<int>([](promise<int>) {}));
+
+  when_any(std::move(c))
+    .then([&](int) -> mc::result<std::string> {
+      return future<std::string>([&](promise<std::string> p) {p2 = std::move(p); })
+        .then([](std::string value) -> mc::result<std::string> {return value + "!"; });
+    })
+    .then([&](std::string value) {result = value; })
+    .ignore_result();
+
+  p1(123);
+  p2(std::string{"hello"});
+  ASSERT_EQ(result, "hello!");
+}
+
+TEST(operations_when_any_variadic, resolves_to_variant_of_first_value) {
+  promise<int> p1;
+  promise<std::string> p2;
+  auto called = std::make_shared<bool>();
+
+  when_any(future<int>([&](promise<int> p) {p1 = std::move(p); }), future<std::string>([&](promise<std::string> p) {p2 = std::move(p); }))
+    .then([called](std::variant<int, std::string> value) {
+      ASSERT_EQ(value.index(), 1);
+      ASSERT_EQ(std::get<1>(value), "hello");
+      *called = true;
+    })
+    .ignore_result();
+
+  ASSERT_FALSE(*called);
+  p2(std::string{"hello"});
+  ASSERT_TRUE(*called);
+
+  p1(123); // Check that it doesn't crash
+}
+
+TEST(operations_when_any_variadic, index_tells_same_types_apart) {
+  future<std::variant<int, std::monostate, int>> fut = when_any(future<int>([](promise<int>) {}), future<void>([](promise<void>) {}), make_successful_future<int>(444));
+  assert_successful_result_eq(std::move(fut), std::variant<int, std::monostate, int>{std::in_place_index<2>, 444});
+}
+
+TEST(operations_when_any_variadic, resolves_to_first_result_even_when_it_is_a_failure) {
+  assert_fail_eq(when_any(make_failed_future<std::string>(444), make_successful_future<int>(123)), 444);
+}
+
+TEST(operations_when_any_success, skips_failures_until_first_success) {
+  promise<int> p1, p2, p3;
+  auto called = std::make_shared<bool>();
+
+  std::vector<future<int>> c;
+  c.push_back(future<int>([&](promise<int> p) {p1 = std::move(p); }));
+  c.push_back(future<int>([&](promise<int> p) {p2 = std::move(p); }));
+  c.push_back(future<int>([&](promise<int> p) {p3 = std::move(p); }));
+
+  when_any_success(std::move(c))
+    .then([called](int value) {
+      ASSERT_EQ(value, 123);
+      *called = true;
+    })
+    .ignore_result();
+
+  p1(failure{444});
+  ASSERT_FALSE(*called);
+  p3(123);
+  ASSERT_TRUE(*called);
+
+  p2(456); // Check that it doesn't crash
+}
+
+TEST(operations_when_any_success, fails_with_last_error_when_all_fail) {
+  std::vector<future<int>> c;
+  c.push_back(make_failed_future<int>(444));
+  c.push_back(make_failed_future<int>(456));
+  assert_fail_eq(when_any_success(std::move(c)), 456);
+}
+
+TEST(operations_when_any_success, error_reducer_receives_all_errors) {
+  std::vector<future<void>> c;
+  c.push_back(make_failed_future<void>(1));
+  c.push_back(make_failed_future<void>(20));
+  c.push_back(make_failed_future<void>(300));
+
+  assert_fail_eq(when_any_success(std::move(c), [](std::vector<int>&& errors) {
+    ASSERT_EQ(errors.size(), 3);
+    return errors[0] + errors[1] + errors[2];
+  }), 321);
+}
+
+TEST(operations_when_any_success, cancels_remaining_futures) {
+  promise<int> p2;
+  bool loser_continued = false;
+
+  std::vector<future<int>> c;
+  c.push_back(make_successful_future<int>(123));
+  c.push_back(future<int>([&](promise<int> p) {p2 = std::move(p); })
+    .then([&](int value) -> mc::result<int> {
+      loser_continued = true;
+      return value;
+    }));
+
+  assert_successful_result_eq(when_any_success(std::move(c)), 123);
+
+  p2(456);
+  ASSERT_FALSE(loser_continued);
+}
+
+TEST(operations_when_n, resolves_with_first_values_in_completion_order) {
+  promise<int> p1, p2, p3;
+  auto called = std::make_shared<bool>();
+
+  std::vector<future<int>> c;
+  c.push_back(future<int>([&](promise<int> p) {p1 = std::move(p); }));
+  c.push_back(future<int>([&](promise<int> p) {p2 = std::move(p); }));
+  c.push_back(future<int>([&](promise<int> p) {p3 = std::move(p); }));
+
+  when_n(2, std::move(c))
+    .then([called](std::vector<int> values) {
+      ASSERT_EQ(values.size(), 2);
+      ASSERT_EQ(values[0], 3);
+      ASSERT_EQ(values[1], 1);
+      *called = true;
+    })
+    .ignore_result();
+
+  p3(3);
+  p2(failure{444});
+  ASSERT_FALSE(*called);
+  p1(1);
+  ASSERT_TRUE(*called);
+}
+
+TEST(operations_when_n, fails_once_quorum_is_unreachable) {
+  promise<void> p3;
+  bool straggler_continued = false;
+
+  std::vector<future<void>> c;
+  c.push_back(make_failed_future<void>(444));
+  c.push_back(make_failed_future<void>(456));
+  c.push_back(future<void>([&](promise<void> p) {p3 = std::move(p); })
+    .then([&]() -> mc::result<void> {
+      straggler_continued = true;
+      return {};
+    }));
+
+  assert_fail_eq(when_n(2, std::move(c)), 456);
+
+  p3({});
+  ASSERT_FALSE(straggler_continued);
+}
+
+TEST(operations_when_n, zero_count_resolves_immediately) {
+  std::vector<future<int>> c;
+  c.push_back(future<int>([](promise<int>) {}));
+  assert_successful_result_eq(when_n(0, std::move(c)), {});
+}
+
 TEST(operations_when_seq, vector_of_successful_futures_returns_successfully) {
   std::vector<future<int>> v;
   v.push_back(make_successful_future<int>(123));
@@ -137,7 +594,7 @@ TEST(operations_when_seq, vector_of_successful_futures_returns_successfully) {
 TEST(operations_when_seq, futures_are_evaluated_in_order) {
   std::vector<future<int>> v;
   promise<int> p1, p2;
-  bool called;
+  bool called = false;
 
   v.push_back(future<int>([&](promise<int> p) {p1 = std::move(p); }));
   v.push_back(future<int>([&](promise<int> p) {p2 = std::move(p); }));
@@ -181,3 +638,412 @@ TEST(operations_when_seq, takes_void) {
   v.push_back(make_successful_future<void>());
   assert_successful_result(when_seq(std::move(v)));
 }
+
+TEST(operations_when_seq, takes_lazily_created_futures) {
+  assert_successful_result_eq(when_seq(future_generator{1}, future_generator{4}), {1, 2, 3});
+}
+
+TEST(operations_when_seq, factory_creates_futures_when_previous_finishes) {
+  promise<int> p[3];
+  int num_created = 0;
+  auto called = std::make_shared<bool>();
+
+  when_seq(3, [&](size_t index) {
+    ++num_created;
+    return future<int>([&p, index](promise<int> new_promise) {p[index] = std::move(new_promise); });
+  })
+  .then([called](std::vector<int> result) {
+    bool eq = result == std::vector<int>{10, 11, 12};
+    ASSERT_TRUE(eq);
+    *called = true;
+  })
+  .ignore_result();
+
+  ASSERT_EQ(num_created, 1);
+  p[0](10);
+  ASSERT_EQ(num_created, 2);
+  p[1](11);
+  ASSERT_EQ(num_created, 3);
+  ASSERT_FALSE(*called);
+  p[2](12);
+  ASSERT_TRUE(*called);
+}
+
+TEST(operations_when_seq, factory_failure_stops_creating_futures) {
+  int num_created = 0;
+
+  auto fut = when_seq(3, [&](size_t index) {
+    ++num_created;
+    return index == 1 ? make_failed_future<int>(444) : make_successful_future<int>(int{static_cast<int>(index)});
+  });
+
+  assert_fail_eq(std::move(fut), 444);
+  ASSERT_EQ(num_created, 2);
+}
+
+TEST(operations_when_seq, factory_with_synchronous_futures_does_not_grow_the_stack) {
+  assert_successful_result(when_seq(1000000, [](size_t) {return make_successful_future<void>(); }));
+}
+
+TEST(operations_when_all_limited, evaluates_at_most_max_in_flight_futures) {
+  promise<int> p[4];
+  auto called = std::make_shared<bool>();
+
+  std::vector<future<int>> v;
+  for (int i = 0; i < 4; ++i)
+    v.push_back(future<int>([&p, i](promise<int> new_promise) {p[i] = std::move(new_promise); }));
+
+  when_all_limited(std::move(v), 2)
+    .then([called](std::vector<int> result) {
+      bool eq = result == std::vector<int>{1, 2, 3, 4};
+      ASSERT_TRUE(eq);
+      *called = true;
+    })
+    .ignore_result();
+
+  ASSERT_TRUE(bool{p[0]});
+  ASSERT_TRUE(bool{p[1]});
+  ASSERT_FALSE(bool{p[2]});
+
+  p[1](2);
+  ASSERT_TRUE(bool{p[2]});
+  ASSERT_FALSE(bool{p[3]});
+
+  p[2](3);
+  ASSERT_TRUE(bool{p[3]});
+
+  p[3](4);
+  ASSERT_FALSE(*called);
+
+  p[0](1);
+  ASSERT_TRUE(*called);
+}
+
+TEST(operations_when_all_limited, failure_stops_evaluation) {
+  promise<int> p1;
+  bool evaluated_last = false;
+
+  std::vector<future<int>> v;
+  v.push_back(future<int>([&](promise<int> p) {p1 = std::move(p); }));
+  v.push_back(make_failed_future<int>(444));
+  v.push_back(future<int>([&](promise<int>) {evaluated_last = true; }));
+
+  assert_fail_eq(when_all_limited(std::move(v), 2), 444);
+  ASSERT_FALSE(evaluated_last);
+}
+
+TEST(operations_when_all_limited, synchronous_futures_do_not_grow_the_stack) {
+  std::vector<future<void>> v;
+  for (int i = 0; i < 100000; ++i)
+    v.push_back(make_successful_future<void>());
+
+  assert_successful_result(when_all_limited(std::move(v), 4));
+}
+
+TEST(operations_when_each, handles_values_in_completion_order) {
+  promise<std::string> p1, p2;
+  std::vector<std::pair<size_t, std::string>> handled;
+  auto called = std::make_shared<bool>();
+
+  std::vector<future<std::string>> v;
+  v.push_back(future<std::string>([&](promise<std::string> p) {p1 = std::move(p); }));
+  v.push_back(future<std::string>([&](promise<std::string> p) {p2 = std::move(p); }));
+
+  when_each(std::move(v), [&](size_t index, std::string value) {
+    handled.emplace_back(index, std::move(value));
+  })
+  .then([called] {*called = true; })
+  .ignore_result();
+
+  p2(std::string{"second"});
+  ASSERT_EQ(handled.size(), 1);
+  ASSERT_EQ(handled[0].first, 1);
+  ASSERT_EQ(handled[0].second, "second");
+  ASSERT_FALSE(*called);
+
+  p1(std::string{"first"});
+  ASSERT_EQ(handled.size(), 2);
+  ASSERT_EQ(handled[1].first, 0);
+  ASSERT_EQ(handled[1].second, "first");
+  ASSERT_TRUE(*called);
+}
+
+TEST(operations_when_each, failure_is_propagated_and_stops_handling) {
+  int num_handled = 0;
+
+  std::vector<future<int>> v;
+  v.push_back(make_successful_future<int>(4));
+  v.push_back(make_failed_future<int>(444));
+  v.push_back(make_successful_future<int>(5));
+
+  assert_fail_eq(when_each(std::move(v), [&](size_t, int) {++num_handled; }), 444);
+  ASSERT_EQ(num_handled, 1);
+}
+
+TEST(operations_when_each, takes_void) {
+  size_t index_sum = 0;
+
+  std::vector<future<void>> v;
+  v.push_back(make_successful_future<void>());
+  v.push_back(make_successful_future<void>());
+
+  assert_successful_result(when_each(std::move(v), [&](size_t index) {index_sum += index + 1; }));
+  ASSERT_EQ(index_sum, 3);
+}
+
+TEST(operations_when_each, empty_vector_returns_immediately) {
+  std::vector<future<int>> v;
+  assert_successful_result(when_each(std::move(v), [](size_t, int) {TEST_FAIL("Shouldn't be called"); }));
+}
+
+TEST(operations_when_all_reduce, folds_values_as_they_arrive) {
+  promise<int> p1, p2;
+  int result = 0;
+
+  std::vector<future<int>> v;
+  v.push_back(future<int>([&](promise<int> p) {p1 = std::move(p); }));
+  v.push_back(future<int>([&](promise<int> p) {p2 = std::move(p); }));
+  v.push_back(make_successful_future<int>(1));
+
+  std::vector<int> folded;
+
+  when_all_reduce(std::move(v), 100, [&](int acc, int value) {
+    folded.push_back(value);
+    return acc + value;
+  })
+  .then([&](int sum) {result = sum; })
+  .ignore_result();
+
+  p2(20);
+  ASSERT_EQ(folded.size(), 2);
+  ASSERT_EQ(folded[1], 20);
+  ASSERT_EQ(result, 0);
+
+  p1(300);
+  ASSERT_EQ(result, 421);
+}
+
+TEST(operations_when_all_reduce, takes_function_objects) {
+  std::vector<future<int>> v;
+  v.push_back(make_successful_future<int>(4));
+  v.push_back(make_successful_future<int>(5));
+  assert_successful_result_eq(when_all_reduce(std::move(v), 1, std::multiplies<int>{}), 20);
+}
+
+TEST(operations_when_all_reduce, failure_is_propagated) {
+  std::vector<future<int>> v;
+  v.push_back(make_successful_future<int>(4));
+  v.push_back(make_failed_future<int>(444));
+  assert_fail_eq(when_all_reduce(std::move(v), 0, std::plus<int>{}), 444);
+}
+
+TEST(operations_when_all_reduce, empty_vector_returns_init) {
+  std::vector<future<int>> v;
+  assert_successful_result_eq(when_all_reduce(std::move(v), std::string{"init"}, [](std::string acc, int) {return acc; }), std::string{"init"});
+}
+
+TEST(operations_hedge, launches_another_attempt_when_delay_expires) {
+  std::vector<promise<int>> attempts;
+  std::vector<promise<void>> timers;
+  bool loser_continued = false;
+  auto called = std::make_shared<bool>();
+
+  hedge([&](size_t attempt) {
+      ASSERT_EQ(attempt, attempts.size());
+      return future<int>([&](promise<int> p) {attempts.push_back(std::move(p)); })
+        .then([&, attempt](int value) -> mc::result<int> {
+          loser_continued = loser_continued || attempt == 0;
+          return value;
+        });
+    },
+    [&] {return future<void>([&](promise<void> p) {timers.push_back(std::move(p)); }); },
+    3)
+    .then([called](int value) {
+      ASSERT_EQ(value, 2);
+      *called = true;
+    })
+    .ignore_result();
+
+  ASSERT_EQ(attempts.size(), 1);
+  ASSERT_EQ(timers.size(), 1);
+
+  timers[0]({});
+  ASSERT_EQ(attempts.size(), 2);
+
+  attempts[1](2);
+  ASSERT_TRUE(*called);
+
+  attempts[0](1);
+  timers[1]({});
+  ASSERT_FALSE(loser_continued);
+  ASSERT_EQ(attempts.size(), 2);
+}
+
+TEST(operations_hedge, failure_launches_next_attempt_right_away) {
+  size_t num_delays = 0;
+
+  auto fut = hedge([](size_t attempt) {
+      return attempt < 2 ? make_failed_future<int>(444) : make_successful_future<int>(static_cast<int>(attempt));
+    },
+    [&] {
+      ++num_delays;
+      return future<void>([](promise<void>) {});
+    },
+    5);
+
+  assert_successful_result_eq(std::move(fut), 2);
+  ASSERT_EQ(num_delays, 0);
+}
+
+TEST(operations_hedge, fails_with_last_error_when_all_attempts_fail) {
+  assert_fail_eq(hedge([](size_t attempt) {return make_failed_future<int>(static_cast<int>(attempt)); },
+                       [] {return make_successful_future<void>(); },
+                       3), 2);
+}
+
+TEST(operations_retry, retries_until_success) {
+  std::vector<std::chrono::milliseconds> delays;
+
+  auto fut = retry([](size_t attempt) {
+      return attempt < 3 ? make_failed_future<int>(444) : make_successful_future<int>(123);
+    },
+    retry_policy{5, std::chrono::milliseconds{100}, 2.0, std::chrono::milliseconds{300}, 0.0},
+    [&](std::chrono::milliseconds delay) {
+      delays.push_back(delay);
+      return make_successful_future<void>();
+    });
+
+  assert_successful_result_eq(std::move(fut), 123);
+  ASSERT_EQ(delays.size(), 3);
+  ASSERT_EQ(delays[0].count(), 100);
+  ASSERT_EQ(delays[1].count(), 200);
+  ASSERT_EQ(delays[2].count(), 300);
+}
+
+TEST(operations_retry, fails_with_last_error_after_max_attempts) {
+  size_t num_attempts = 0;
+
+  auto fut = retry([&](size_t attempt) {
+      ++num_attempts;
+      return make_failed_future<int>(static_cast<int>(attempt));
+    },
+    retry_policy{4},
+    [](std::chrono::milliseconds) {return make_successful_future<void>(); });
+
+  assert_fail_eq(std::move(fut), 3);
+  ASSERT_EQ(num_attempts, 4);
+}
+
+TEST(operations_retry, waits_for_sleep_between_attempts) {
+  promise<void> wakeup;
+  size_t num_attempts = 0;
+
+  auto fut = retry([&](size_t) {
+      ++num_attempts;
+      return num_attempts == 1 ? make_failed_future<int>(444) : make_successful_future<int>(123);
+    },
+    retry_policy{},
+    [&](std::chrono::milliseconds delay) {
+      // Jitter only ever shortens the delay
+      ASSERT_TRUE((delay.count() >= 50 && delay.count() <= 100));
+      return future<void>([&](promise<void> p) {wakeup = std::move(p); });
+    });
+
+  auto called = std::make_shared<bool>();
+  std::move(fut).then([called](int value) {
+    ASSERT_EQ(value, 123);
+    *called = true;
+  }).ignore_result();
+
+  ASSERT_EQ(num_attempts, 1);
+  wakeup({});
+  ASSERT_EQ(num_attempts, 2);
+  ASSERT_TRUE(*called);
+}
+
+TEST(operations_retry, default_policies_jitter_differently) {
+  auto delays_of_failing_retry = [] {
+    std::vector<std::chrono::milliseconds::rep> delays;
+
+    retry([](size_t) {return make_failed_future<int>(444); },
+      retry_policy{8, std::chrono::milliseconds{1000000}, 1.0, std::chrono::milliseconds{1000000}},
+      [&](std::chrono::milliseconds delay) {
+        delays.push_back(delay.count());
+        return make_successful_future<void>();
+      }).ignore_result();
+
+    return delays;
+  };
+
+  const auto first = delays_of_failing_retry();
+  const auto second = delays_of_failing_retry();
+
+  ASSERT_EQ(first.size(), 7);
+  ASSERT_TRUE((first != second));
+}
+
+TEST(operations_retry, many_synchronous_attempts_do_not_grow_the_stack) {
+  auto fut = retry([](size_t attempt) {
+      return attempt < 99999 ? make_failed_future<int>(444) : make_successful_future<int>(static_cast<int>(attempt));
+    },
+    retry_policy{100000},
+    [](std::chrono::milliseconds) {return make_successful_future<void>(); });
+
+  assert_successful_result_eq(std::move(fut), 99999);
+}
+
+TEST(operations_repeat, runs_body_until_it_resolves_to_false) {
+  int num_iterations = 0;
+  promise<bool> pending;
+
+  auto called = std::make_shared<bool>();
+  repeat([&] {
+      ++num_iterations;
+
+      if (num_iterations == 2)
+        return future<bool>([&](promise<bool> p) {pending = std::move(p); });
+
+      return make_successful_future<bool>(num_iterations < 4);
+    })
+    .then([called] {*called = true; })
+    .ignore_result();
+
+  ASSERT_EQ(num_iterations, 2);
+  ASSERT_FALSE(*called);
+  pending(true);
+  ASSERT_EQ(num_iterations, 4);
+  ASSERT_TRUE(*called);
+}
+
+TEST(operations_repeat, failure_is_propagated) {
+  int num_iterations = 0;
+  assert_fail_eq(repeat([&] {return ++num_iterations < 3 ? make_successful_future<bool>(true) : make_failed_future<bool>(444); }), 444);
+  ASSERT_EQ(num_iterations, 3);
+}
+
+TEST(operations_repeat, many_synchronous_iterations_do_not_grow_the_stack) {
+  int num_iterations = 0;
+  assert_successful_result(repeat([&] {return make_successful_future<bool>(++num_iterations < 1000000); }));
+  ASSERT_EQ(num_iterations, 1000000);
+}
+
+TEST(operations_while, checks_condition_before_each_iteration) {
+  int num_iterations = 0;
+  assert_successful_result(while_([&] {return num_iterations < 5; }, [&] {
+    ++num_iterations;
+    return make_successful_future<void>();
+  }));
+  ASSERT_EQ(num_iterations, 5);
+
+  assert_successful_result(while_([] {return false; }, [&] {
+    ++num_iterations;
+    return make_successful_future<void>();
+  }));
+  ASSERT_EQ(num_iterations, 5);
+}
+
+TEST(operations_while, body_can_stop_the_loop) {
+  int num_iterations = 0;
+  assert_successful_result(while_([] {return true; }, [&] {return make_successful_future<bool>(++num_iterations < 3); }));
+  ASSERT_EQ(num_iterations, 3);
+}
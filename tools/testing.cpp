@@ -2,7 +2,8 @@
 
 #include "testing.h"
 
-static bool alloc_reporting_enabled = true;
+// Per thread, since it guards against the allocation tracking recursing into itself
+static thread_local bool alloc_reporting_enabled = true;
 
 int main() {
   testing::test_system::instance().run_suites();